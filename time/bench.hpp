@@ -0,0 +1,72 @@
+#pragma once
+
+#include "impl/bench.ipp"
+
+namespace wax {
+
+//! @namespace bench
+//  @brief Micro-benchmarks timed with the stopwatch clocks.
+//
+//  void copy_small( wax::bench::state &st ) {
+//      char a[ 64 ], b[ 64 ] = {};
+//      for ( auto _ : st ) {
+//          memcpy( a, b, sizeof a );
+//          wax::bench::clobber_memory();
+//      }
+//  }
+//  WAX_BENCHMARK( copy_small );
+//  WAX_BENCHMARK_MAIN();
+//
+//  Each benchmark's batch grows until it runs for at least --min-time, is warmed up, then timed
+//  --repetitions times.  A noisy result is retried with bigger batches.  The JSON report on
+//  standard output gives each benchmark's median, median absolute deviation and minimum time
+//  per iteration, and the clock it was timed on.  --clock=cpu times with this thread's CPU time
+//  instead of wall time, except for benchmarks on several threads.  Anything a benchmark adds
+//  with st.counter( name, value ) is reported beside its times, per iteration like them.
+//
+namespace bench {
+
+using state    = ::wax::_impl::bench::state;
+using function = ::wax::_impl::bench::function;
+
+//! @brief Make the compiler believe value is read, so computing it can't be optimized away.
+template< typename value_type >
+inline void do_not_optimize( const value_type &value ) noexcept( true ) {
+    asm volatile( "" : : "r,m"( value ) : "memory" );
+}
+
+//! @brief As above, and also that value may have been changed.
+template< typename value_type >
+inline void do_not_optimize( value_type &value ) noexcept( true ) {
+    asm volatile( "" : "+r,m"( value ) : : "memory" );
+}
+
+//! @brief Make the compiler believe all memory may have been read and written.
+inline void clobber_memory() noexcept( true ) { asm volatile( "" : : : "memory" ); }
+
+//! @brief Register fn under name.  WAX_BENCHMARK() does this during static initialization.
+//
+//  With threads above 1, that many threads each run the whole loop at once, for contention;
+//  times are then per iteration over all of them, and on the real clock.
+//
+inline void add( const char *name, function fn, unsigned threads = 1 ) {
+    ::wax::_impl::bench::registrar( name, fn, threads );
+}
+
+//! @brief Run every registered benchmark; see WAX_BENCHMARK_MAIN() for the arguments.
+//  @return Exit status.
+inline int run( int argc, char **argv ) { return ::wax::_impl::bench::run( argc, argv ); }
+
+}
+}
+
+//! @brief Register void fn( wax::bench::state & ) as a benchmark named fn.
+#define WAX_BENCHMARK( fn ) \
+    static const ::wax::_impl::bench::registrar wax_bench_##fn( #fn, fn )
+
+//! @brief Define main() to run the registered benchmarks.
+//
+//  prog [--filter=text] [--clock=real|cpu] [--min-time=ms] [--repetitions=n] [--out=path]
+//
+#define WAX_BENCHMARK_MAIN() \
+    int main( int argc, char **argv ) { return ::wax::bench::run( argc, argv ); }
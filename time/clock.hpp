@@ -0,0 +1,62 @@
+#pragma once
+
+#include "impl/sw_clock.ipp"
+
+namespace wax {
+namespace stopwatch {
+
+//! @namespace stopwatch::clock
+//  @brief The clocks, and reading them with nothing else: the hot path on its own.
+//
+//  For code that only wants to time, or that is included everywhere, this header is enough:
+//
+//      const auto t0 = stopwatch::clock::ticks< stopwatch::clock::monotonic >();
+//      ...
+//      const int64_t ns = stopwatch::clock::lap_ns< stopwatch::clock::monotonic >( t0 );
+//
+//  It includes no C++ library headers and runs nothing during static initialization.  The
+//  stopwatches, sinks and output are in stopwatch.hpp; see stopwatch::real and the rest there
+//  for what each clock costs.
+//
+namespace clock {
+    using type = ::wax::_impl::clock::_hw_type;
+    static constexpr     type real          = ::wax::_impl::clock::real;
+    static constexpr     type monotonic     = ::wax::_impl::clock::monotonic;
+    static constexpr     type monotonic_raw = ::wax::_impl::clock::monotonic_raw;
+    static constexpr     type coarse        = ::wax::_impl::clock::coarse;
+    static constexpr     type boottime      = ::wax::_impl::clock::boottime;
+    namespace cpu {
+        static constexpr type thread        = ::wax::_impl::clock::cpu::thread;
+        static constexpr type proc          = ::wax::_impl::clock::cpu::proc;
+    }
+    static constexpr     type tsc           = ::wax::_impl::clock::tsc;
+
+    //! @brief A raw reading: nanoseconds, or cycles for tsc.
+    using tick_type = ::wax::_impl::clock::tick_type;
+
+    //! @return The clock now, in ticks.
+    template< type clock_type >
+    inline tick_type ticks() noexcept( true ) { return ::wax::_impl::clock::ticks< clock_type >(); }
+
+    //! @return Nanoseconds in a span of ticks.
+    template< type clock_type >
+    inline int64_t to_ns( tick_type span ) noexcept( true ) {
+        return ::wax::_impl::clock::to_ns< clock_type >( span );
+    }
+
+    //! @return Nanoseconds since start, a reading from ticks().
+    template< type clock_type >
+    inline int64_t lap_ns( tick_type start ) noexcept( true ) {
+        return ::wax::_impl::clock::to_ns< clock_type >( ::wax::_impl::clock::ticks< clock_type >()
+                                                        - start );
+    }
+
+    //! @return The clock's resolution in nanoseconds, queried once per process.
+    template< type clock_type >
+    inline unsigned long resolution() noexcept( true ) {
+        return ::wax::_impl::clock::resolution< clock_type >();
+    }
+}
+
+}
+}
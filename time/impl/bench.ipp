@@ -0,0 +1,375 @@
+#pragma once
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "sw_base.ipp"
+
+namespace wax {
+namespace _impl {
+namespace bench {
+
+//! @brief Per-run handle given to a benchmark function.
+//
+//  void work( wax::bench::state &st ) { for ( auto _ : st ) { ... } }
+//
+// Only the body of the range-for is timed.  Timing reads the clock directly rather than through
+// a stopwatch alias, so WAX_STOPWATCH_DISABLE doesn't turn benchmarks off.
+//
+class state
+{
+  public:
+
+    using now_fn   = int64_t (*)();
+    using counters = std::vector< std::pair< std::string, double > >;
+
+    state( uint64_t iterations, now_fn now, unsigned index = 0 )
+        :
+        n( iterations ),
+        now( now ),
+        index( index )
+    {}
+
+    struct sentinel {};
+
+    //! @brief What the loop variable holds.  Not trivial, so it isn't reported as unused.
+    struct value { value() noexcept( true ) {} ~value() {} };
+
+    class iterator
+    {
+      public:
+        explicit iterator( state *s ) noexcept( true ) : s( s ), left( s->n ) {}
+        bool operator!=( sentinel ) noexcept( true ) {
+            if ( __builtin_expect( left != 0, 1 ) ) return true;
+            s->stop = s->now();
+            return false;
+        }
+        void operator++() noexcept( true ) { --left; }
+        value operator*() const noexcept( true ) { return {}; }
+      private:
+        state    *s;
+        uint64_t  left;
+    };
+
+    iterator begin() noexcept( true ) {
+        start = now();
+        return iterator( this );
+    }
+
+    sentinel end() noexcept( true ) { return {}; }
+
+    //! @return Iterations this run will make.
+    uint64_t iterations() const noexcept( true ) { return n; }
+
+    //! @return Nanoseconds the timed loop took.
+    int64_t elapsed_ns() const noexcept( true ) { return stop - start; }
+
+    //! @return Clock readings as the timed loop began and ended.
+    int64_t start_ns() const noexcept( true ) { return start; }
+    int64_t stop_ns()  const noexcept( true ) { return stop; }
+
+    //! @return Which of the benchmark's threads this is, from 0.
+    unsigned thread() const noexcept( true ) { return index; }
+
+    //! @brief Add value to a counter reported with the result, e.g. once after the loop.
+    //
+    // Counters are summed over the timed batches and every thread, then given per iteration
+    // over all threads like the times.
+    //
+    void counter( const char *name, double value ) {
+        for ( auto &c : extra )
+            if ( c.first == name ) { c.second += value; return; }
+        extra.emplace_back( name, value );
+    }
+
+    //! @return The counters added to so far.
+    const counters &counted() const noexcept( true ) { return extra; }
+
+  private:
+
+    uint64_t  n;
+    now_fn    now;
+    unsigned  index;
+    int64_t   start   { 0 };
+    int64_t   stop    { 0 };
+    counters  extra;
+};
+
+//! @brief Add every counter in from to the same one in to.
+inline void add_counters( state::counters &to, const state::counters &from ) {
+    for ( const auto &f : from ) {
+        auto t = to.begin();
+        while ( t != to.end() && t->first != f.first ) ++t;
+        if ( t == to.end() ) to.push_back( f );
+        else t->second += f.second;
+    }
+}
+
+using function = void (*)( state & );
+
+struct entry {
+    std::string  name;
+    function     fn;
+    unsigned     threads;       //< Running the loop at once, each all of its iterations.
+};
+
+//! @return Every registered benchmark, in registration order.
+inline std::vector< entry > &registry() {
+    static std::vector< entry > r;
+    return r;
+}
+
+struct registrar {
+    registrar( const char *name, function fn, unsigned threads = 1 ) {
+        registry().push_back( { name, fn, threads ? threads : 1 } );
+    }
+};
+
+struct options {
+    const char      *filter       { nullptr };
+    const char      *out          { nullptr };
+    bool             cpu          {   false };
+    int64_t          min_batch_ns {  10000000 };
+    int64_t          warmup_ns    { 100000000 };
+    unsigned         repetitions  {      15 };
+    double           max_spread   {    0.05 };      //< MAD / median considered stable.
+    unsigned         max_rounds   {       4 };
+};
+
+struct result {
+    std::string  name;
+    const char  *clock;         //< Timed on, which is real for several threads whatever asked.
+    unsigned     threads;
+    uint64_t     iterations;
+    unsigned     repetitions;
+    double       median_ns;
+    double       mad_ns;
+    double       min_ns;
+    state::counters counters;   //< Per iteration over all threads, as the times.
+};
+
+inline int64_t real_now()   noexcept( true ) { return clock::now< clock::real >(); }
+inline int64_t thread_now() noexcept( true ) { return clock::now< clock::cpu::thread >(); }
+
+//! @return Nanoseconds for one batch of n iterations on each of the entry's threads.
+//
+// With more than one thread the threads meet at a barrier first, and the batch runs from the
+// first loop starting to the last one ending, on the real clock: CPU times of different
+// threads can't be compared.
+//
+inline int64_t batch( const entry &e, uint64_t n, state::now_fn now,
+                      state::counters *counted = nullptr ) {
+    if ( e.threads == 1 ) {
+        state st( n, now );
+        e.fn( st );
+        if ( counted ) add_counters( *counted, st.counted() );
+        return st.elapsed_ns();
+    }
+    std::vector< state > st;
+    for ( unsigned i = 0; i < e.threads; ++i ) st.emplace_back( n, real_now, i );
+    std::atomic< unsigned > waiting { e.threads };
+    auto run = [ & ]( state &s ) {
+        waiting.fetch_sub( 1, std::memory_order_acq_rel );
+        while ( waiting.load( std::memory_order_acquire ) ) std::this_thread::yield();
+        e.fn( s );
+    };
+    std::vector< std::thread > others;
+    for ( unsigned i = 1; i < e.threads; ++i ) others.emplace_back( run, std::ref( st[ i ] ) );
+    run( st[ 0 ] );
+    for ( auto &t : others ) t.join();
+    int64_t first = st[ 0 ].start_ns(), last = st[ 0 ].stop_ns();
+    for ( const auto &s : st ) {
+        first = std::min( first, s.start_ns() );
+        last  = std::max( last, s.stop_ns() );
+        if ( counted ) add_counters( *counted, s.counted() );
+    }
+    return last - first;
+}
+
+inline double median( std::vector< double > v ) {
+    if ( v.empty() ) return 0;
+    const size_t mid = v.size() / 2;
+    std::nth_element( v.begin(), v.begin() + mid, v.end() );
+    if ( v.size() & 1 ) return v[ mid ];
+    const double hi = v[ mid ];
+    return ( *std::max_element( v.begin(), v.begin() + mid ) + hi ) / 2;
+}
+
+//! @brief Time one benchmark.
+//
+// Grows the batch until one takes at least min_batch_ns, runs batches for warmup_ns and throws
+// them away, then times repetitions batches.  If the spread is still wide it doubles the batch
+// and tries again, up to max_rounds times, keeping the steadiest round.  Times are per
+// iteration over all threads, so on several threads they are the inverse of the throughput.
+//
+inline result measure( const entry &e, const options &opt ) {
+    const bool          cpu = opt.cpu && e.threads == 1;
+    const state::now_fn now = cpu ? thread_now : real_now;
+
+    uint64_t n = 1;
+    for ( ;; ) {
+        const int64_t t = batch( e, n, now );
+        if ( t >= opt.min_batch_ns || n >= ( 1UL << 40 ) ) break;
+        const double grow = t > 0 ? 1.4 * opt.min_batch_ns / t : 10.0;
+        n = (uint64_t) ( n * std::min( 10.0, std::max( 2.0, grow ) ) );
+    }
+
+    for ( int64_t spent = 0; spent < opt.warmup_ns; ) {
+        const int64_t t = batch( e, n, now );
+        spent += t > 0 ? t : opt.min_batch_ns;
+    }
+
+    result best { e.name, cpu ? "cpu::thread" : "real", e.threads, n, opt.repetitions, 0, -1, 0,
+                  {} };
+    std::vector< double > per_iter( opt.repetitions );
+    for ( unsigned round = 0; round < opt.max_rounds; ++round, n *= 2 ) {
+        state::counters counted;
+        for ( auto &x : per_iter )
+            x = (double) batch( e, n, now, &counted ) / ( n * e.threads );
+        const double med = median( per_iter );
+        std::vector< double > dev( per_iter.size() );
+        for ( size_t i = 0; i < dev.size(); ++i ) dev[ i ] = std::abs( per_iter[ i ] - med );
+        const double mad = median( dev );
+        if ( best.mad_ns < 0 || mad / med < best.mad_ns / best.median_ns ) {
+            best.iterations = n;
+            best.median_ns  = med;
+            best.mad_ns     = mad;
+            best.min_ns     = *std::min_element( per_iter.begin(), per_iter.end() );
+            best.counters   = counted;
+            for ( auto &c : best.counters ) c.second /= (double) n * e.threads * per_iter.size();
+        }
+        if ( med > 0 && mad / med <= opt.max_spread ) break;
+    }
+    return best;
+}
+
+//! @brief Append s to out as a JSON string.
+inline void json_string( std::string &out, const char *s ) {
+    out += '"';
+    for ( ; *s; ++s ) {
+        const unsigned char c = *s;
+        if ( c == '"' || c == '\\' ) { out += '\\'; out += c; }
+        else if ( c < 0x20 ) { char u[ 8 ]; snprintf( u, sizeof u, "\\u%04x", c ); out += u; }
+        else out += c;
+    }
+    out += '"';
+}
+
+inline std::string report( const std::vector< result > &results, const options &opt ) {
+    char host[ 256 ] = "";
+    (void) ::gethostname( host, sizeof host - 1 );
+    char when[ 64 ] = "";
+    const time_t t = ::time( nullptr );
+    struct tm tm;
+    ::strftime( when, sizeof when, "%Y-%m-%dT%H:%M:%SZ", ::gmtime_r( &t, &tm ) );
+
+    std::string out = "{\n  \"context\": { \"host\": ";
+    json_string( out, host );
+    out += ", \"date\": ";
+    json_string( out, when );
+    out += opt.cpu ? ", \"clock\": \"cpu::thread\"" : ", \"clock\": \"real\"";
+    out += " },\n  \"benchmarks\": [";
+    char line[ 256 ];
+    for ( size_t i = 0; i < results.size(); ++i ) {
+        const auto &r = results[ i ];
+        out += i ? ",\n    { \"name\": " : "\n    { \"name\": ";
+        json_string( out, r.name.c_str() );
+        snprintf( line, sizeof line,
+                  ", \"clock\": \"%s\", \"threads\": %u, \"iterations\": %lu, \"repetitions\": %u, "
+                  "\"median_ns\": %.3f, \"mad_ns\": %.3f, \"min_ns\": %.3f",
+                  r.clock, r.threads, (unsigned long) r.iterations, r.repetitions, r.median_ns,
+                  r.mad_ns, r.min_ns );
+        out += line;
+        for ( size_t j = 0; j < r.counters.size(); ++j ) {
+            out += j ? ", " : ", \"counters\": { ";
+            json_string( out, r.counters[ j ].first.c_str() );
+            snprintf( line, sizeof line, ": %.6g", r.counters[ j ].second );
+            out += line;
+        }
+        out += r.counters.empty() ? " }" : " } }";
+    }
+    out += "\n  ]\n}\n";
+    return out;
+}
+
+//! @brief Value of --name=value, or nullptr if arg is something else.
+inline const char *flag( const char *arg, const char *name ) {
+    const size_t n = ::strlen( name );
+    return ::strncmp( arg, name, n ) == 0 && arg[ n ] == '=' ? arg + n + 1 : nullptr;
+}
+
+//! @brief Parse a whole decimal count no greater than most into n.
+//  @return False, leaving n alone, if v is anything else.
+inline bool count( const char *v, unsigned long most, unsigned &n ) {
+    if ( *v < '0' || *v > '9' ) return false;
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long x = ::strtoul( v, &end, 10 );
+    if ( errno || *end || x > most ) return false;
+    n = (unsigned) x;
+    return true;
+}
+
+//! @brief Run the registered benchmarks as main() would.
+//
+//  --filter=text       Only benchmarks whose name contains text.
+//  --clock=real|cpu    Time with CLOCK_REALTIME (default) or this thread's CPU time.  Entries on
+//                      several threads are always on the real clock; each result says which.
+//  --min-time=ms       Shortest batch; the iteration count grows to reach it.
+//  --repetitions=n     Batches timed per round, at most 100000; fewer than 3 count as 3.
+//  --out=path          Write the JSON report there instead of standard output.
+//
+inline int run( int argc, char **argv ) {
+    options opt;
+    for ( int i = 1; i < argc; ++i ) {
+        const char *v;
+        bool        ok = true;
+        if      ( ( v = flag( argv[ i ], "--filter" ) ) )      opt.filter = v;
+        else if ( ( v = flag( argv[ i ], "--out" ) ) )         opt.out = v;
+        else if ( ( v = flag( argv[ i ], "--clock" ) ) )       opt.cpu = ! ::strcmp( v, "cpu" );
+        else if ( ( v = flag( argv[ i ], "--min-time" ) ) )
+            opt.min_batch_ns = ::atol( v ) * 1000000;
+        else if ( ( v = flag( argv[ i ], "--repetitions" ) ) )
+            ok = count( v, 100000, opt.repetitions );
+        else ok = false;
+        if ( ! ok ) {
+            fprintf( stderr, "usage: %s [--filter=text] [--clock=real|cpu] [--min-time=ms] "
+                     "[--repetitions=n] [--out=path]\n", argv[ 0 ] );
+            return 2;
+        }
+    }
+    if ( opt.repetitions < 3 ) opt.repetitions = 3;
+
+    std::vector< result > results;
+    for ( const auto &e : registry() ) {
+        if ( opt.filter && ! ::strstr( e.name.c_str(), opt.filter ) ) continue;
+        fprintf( stderr, "%s...\n", e.name.c_str() );
+        results.push_back( measure( e, opt ) );
+    }
+
+    const std::string json = report( results, opt );
+    FILE *f = opt.out ? ::fopen( opt.out, "w" ) : stdout;
+    if ( ! f ) {
+        fprintf( stderr, "%s: %s\n", opt.out, strerror( errno ) );
+        return 1;
+    }
+    fputs( json.c_str(), f );
+    if ( f != stdout ) fclose( f );
+    return 0;
+}
+
+}
+}
+}
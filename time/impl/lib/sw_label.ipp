@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "../sw_label.ipp"
+
+namespace wax {
+namespace _impl {
+namespace label {
+
+namespace _impl {
+
+class registry
+{
+  public:
+
+    static constexpr unsigned chunk_bits = 8;
+    static_assert( max_ids == 1U << ( 2 * chunk_bits ), "two levels of chunks cover the ids" );
+
+    //! @return The process-wide registry.  Never destroyed.
+    static registry &get() {
+        static registry *r = new registry;
+        return *r;
+    }
+
+    id_type intern( const char *s ) {
+        if ( ! s ) return none;
+        const uint64_t h = hash( s );
+        for ( unsigned i = slot( h ), probes = 0; probes < max_probes;
+              i = ( i + 1 ) & ( cache_size - 1 ), ++probes ) {
+            const uint64_t k = cache[ i ].key.load( std::memory_order_acquire );
+            if ( ! k ) break;
+            if ( k != h ) continue;
+            const id_type id = cache[ i ].id.load( std::memory_order_relaxed );
+            if ( ::strcmp( name( id ), s ) == 0 ) return id;
+        }
+        return insert( s, h );
+    }
+
+    //! @return The text of an id, or nullptr if there is no such id.
+    const char *name( id_type id ) const noexcept( true ) {
+        if ( id == none || id >= max_ids ) return nullptr;
+        const char * const *chunk = chunks[ id >> chunk_bits ].load( std::memory_order_acquire );
+        return chunk ? chunk[ id & ( chunk_size - 1 ) ] : nullptr;
+    }
+
+    //! @return The highest id handed out so far.
+    id_type last() const noexcept( true ) { return count.load( std::memory_order_acquire ); }
+
+  private:
+
+    static constexpr unsigned cache_size = 4096;
+    static constexpr unsigned max_probes = 16;
+    static constexpr unsigned chunk_size = 1U << chunk_bits;
+
+    registry() = default;
+
+    //! @return FNV-1a of the text, never 0: 0 marks an empty cache entry.
+    static uint64_t hash( const char *s ) noexcept( true ) {
+        uint64_t h = 0xcbf29ce484222325UL;
+        for ( ; *s; ++s ) h = ( h ^ (unsigned char) *s ) * 0x100000001b3UL;
+        return h ? h : 1;
+    }
+
+    static unsigned slot( uint64_t h ) noexcept( true ) {
+        return ( h * 0x9e3779b97f4a7c15UL >> 40 ) & ( cache_size - 1 );
+    }
+
+    id_type insert( const char *s, uint64_t h ) {
+        std::lock_guard< std::mutex > hold( lock );
+
+        id_type id;
+        auto found = by_name.find( s );
+        if ( found != by_name.end() ) {
+            id = found->second;
+        } else {
+            id = count.load( std::memory_order_relaxed ) + 1;
+            if ( id >= max_ids ) return none;
+            auto &chunk = chunks[ id >> chunk_bits ];
+            const char **c = chunk.load( std::memory_order_relaxed );
+            if ( ! c ) {
+                c = new const char *[ chunk_size ]();
+                chunk.store( c, std::memory_order_release );
+            }
+            names.emplace_back( s );
+            c[ id & ( chunk_size - 1 ) ] = names.back().c_str();
+            by_name.emplace( names.back(), id );
+            count.store( id, std::memory_order_release );
+        }
+
+        // Remember the text's hash.  If its neighbourhood is full it just keeps coming through
+        // here.
+        for ( unsigned i = slot( h ), probes = 0; probes < max_probes;
+              i = ( i + 1 ) & ( cache_size - 1 ), ++probes ) {
+            const uint64_t k = cache[ i ].key.load( std::memory_order_relaxed );
+            if ( k == h && cache[ i ].id.load( std::memory_order_relaxed ) == id ) break;
+            if ( ! k ) {
+                cache[ i ].id.store( id, std::memory_order_relaxed );
+                cache[ i ].key.store( h, std::memory_order_release );
+                break;
+            }
+        }
+        return id;
+    }
+
+    struct entry {
+        std::atomic< uint64_t >      key  {       0 };     //< Hash of the text; 0 if unused.
+        std::atomic< id_type >       id   {    none };
+    };
+
+    entry                                   cache[ cache_size ];
+    std::atomic< const char ** >            chunks[ max_ids >> chunk_bits ] {};
+    std::atomic< id_type >                  count  { none };
+
+    std::mutex                              lock;
+    std::deque< std::string >               names;
+    std::unordered_map< std::string, id_type > by_name;
+};
+
+}
+
+WAX_STOPWATCH_API id_type intern( const char *s ) { return _impl::registry::get().intern( s ); }
+
+WAX_STOPWATCH_API const char *name( id_type id ) noexcept( true ) {
+    return _impl::registry::get().name( id );
+}
+
+WAX_STOPWATCH_API id_type last() noexcept( true ) { return _impl::registry::get().last(); }
+
+}
+}
+}
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../sw_format.ipp"
+#include "../sw_label.ipp"
+#include "../sw_report.ipp"
+#include "../sw_thread.ipp"
+
+namespace wax {
+namespace _impl {
+namespace report {
+
+namespace _impl {
+
+//! @brief Single-producer, single-consumer ring of records.
+class ring
+{
+  public:
+
+    static constexpr uint64_t capacity   = 4096;
+    static constexpr uint64_t high_water = capacity / 4;
+
+    //! @return False if the ring was full and the record was dropped.
+    //  @param wake Set once the ring fills past high_water, until it has been drained below.
+    bool push( const record &r, bool &wake ) noexcept( true ) {
+        const uint64_t h = head.load( std::memory_order_relaxed );
+        if ( h - cached_tail >= high_water ) {
+            cached_tail = tail.load( std::memory_order_acquire );
+            if ( h - cached_tail >= capacity ) {
+                dropped.fetch_add( 1, std::memory_order_relaxed );
+                return false;
+            }
+            // One wake per rise past the mark, not one per record above it.
+            const bool high = h - cached_tail >= high_water;
+            wake      = high && ! signalled;
+            signalled = high;
+        }
+        slots[ h & ( capacity - 1 ) ] = r;
+        head.store( h + 1, std::memory_order_release );
+        return true;
+    }
+
+    //! @brief Consumer side: hand every queued record to f.
+    template< typename fn_type >
+    void drain( fn_type &&f ) {
+        const uint64_t h = head.load( std::memory_order_acquire );
+        uint64_t       t = tail.load( std::memory_order_relaxed );
+        for ( ; t != h; ++t ) f( slots[ t & ( capacity - 1 ) ] );
+        tail.store( t, std::memory_order_release );
+    }
+
+    std::atomic< bool >      retired   { false };
+    std::atomic< uint64_t >  dropped   {     0 };
+
+  private:
+
+    static_assert( ( capacity & ( capacity - 1 ) ) == 0, "ring capacity must be a power of 2" );
+
+    alignas( ::wax::_impl::cache_line ) std::atomic< uint64_t > head { 0 };
+    uint64_t                                                    cached_tail { 0 };
+    bool                                                        signalled   { false };
+    alignas( ::wax::_impl::cache_line ) std::atomic< uint64_t > tail { 0 };
+    alignas( ::wax::_impl::cache_line ) record                  slots[ capacity ];
+};
+
+//! @brief Append one formatted line for r to out, e.g. "parse: 1.234567 ms".
+//
+// The duration is shown in the unit its size suits, to the resolution of the clock it came
+// from; see format::duration().  Only out grows, and it is reused from one drain to the next.
+//
+inline void format( std::string &out, const record &r ) {
+    const char  *name  = ::wax::_impl::label::name( r.label );
+    const char  *label = name ? name : "<anon>";
+    const size_t len   = ::strnlen( label, 200 );
+    char         line[ 8 + 200 + 2 + ::wax::_impl::format::max_duration + 1 ];
+    char        *p     = line;
+    for ( unsigned d = r.depth < 4 ? r.depth : 4; d; --d, p += 2 ) p[ 0 ] = p[ 1 ] = ' ';
+    ::memcpy( p, label, len );
+    p += len;
+    *p++ = ':';
+    *p++ = ' ';
+    if ( r.kind == ratio )
+        p = ::wax::_impl::format::percent( p, r.ns );
+    else if ( r.kind == count )
+        p = std::to_chars( p, p + ::wax::_impl::format::max_duration, r.ns ).ptr;
+    else
+        p = ::wax::_impl::format::duration( p, r.ns, ::wax::_impl::format::grain( r.clock ) );
+    *p++ = '\n';
+    out.append( line, p - line );
+}
+
+WAX_STOPWATCH_API void write_all( int fd, struct iovec *iov, int n ) {
+    while ( n > 0 ) {
+        const int batch = n < IOV_MAX ? n : IOV_MAX;
+        ssize_t   done  = ::writev( fd, iov, batch );
+        if ( done < 0 ) {
+            if ( errno == EINTR ) continue;
+            return;
+        }
+        while ( n > 0 && (size_t) done >= iov->iov_len ) {
+            done -= iov->iov_len;
+            ++iov;
+            --n;
+        }
+        if ( n > 0 ) {
+            iov->iov_base = static_cast< char * >( iov->iov_base ) + done;
+            iov->iov_len -= done;
+        }
+    }
+}
+
+//! @brief Owns the rings and the thread that drains them.
+class reporter
+{
+  public:
+
+    static constexpr auto interval = std::chrono::milliseconds( 10 );
+
+    //! @return The process-wide reporter.  Never destroyed; stopped and drained at exit, when
+    //  it says on standard error how many lines it lost, if any.
+    static reporter &get() {
+        static reporter *r = [] {
+            auto *r = new reporter;
+            std::atexit( [] {
+                get().stop();
+                if ( const uint64_t n = get().dropped() )
+                    ::fprintf( stderr, "wax::stopwatch: %lu report lines dropped\n",
+                               (unsigned long) n );
+            } );
+            return r;
+        }();
+        return *r;
+    }
+
+    //! @brief Queue a record from the calling thread, waking the writer early if its ring is
+    //  filling faster than the interval empties it.
+    void push( const record &r ) {
+        ring *mine = local();
+        if ( ! mine ) {
+            // Exiting, or the thread died before its ring could be made: write it here.
+            std::string line;
+            format( line, r );
+            struct iovec iov { &line[ 0 ], line.size() };
+            write_all( r.fd, &iov, 1 );
+            return;
+        }
+        bool hurry = false;
+        mine->push( r, hurry );
+        if ( __builtin_expect( hurry, 0 ) ) wake.notify_one();
+    }
+
+    //! @brief Format and write everything queued so far.
+    void flush() {
+        std::lock_guard< std::mutex > hold( drain_lock );
+        drain();
+    }
+
+    //! @return Records dropped because a ring was full.
+    uint64_t dropped() {
+        std::lock_guard< std::mutex > hold( rings_lock );
+        uint64_t n = lost;
+        for ( ring *r : rings ) n += r->dropped.load( std::memory_order_relaxed );
+        return n;
+    }
+
+    //! @brief Stop the background thread and write everything still queued.
+    void stop() {
+        {
+            std::lock_guard< std::mutex > hold( rings_lock );
+            if ( stopping ) return;
+            stopping = true;
+        }
+        wake.notify_all();
+        if ( flusher.joinable() ) flusher.join();
+        flush();
+    }
+
+  private:
+
+    reporter() = default;
+
+    //! @return The calling thread's ring, made on first use, or nullptr once stopping.
+    ring *local() {
+        struct holder {
+            ring *r    { nullptr };
+            bool  dead {   false };
+            ~holder() {
+                if ( r ) r->retired.store( true, std::memory_order_release );
+                r    = nullptr;
+                dead = true;
+            }
+        };
+        static thread_local holder h;
+        if ( __builtin_expect( h.r == nullptr, 0 ) ) {
+            std::lock_guard< std::mutex > hold( rings_lock );
+            // Later thread_local destructors on an exiting thread land here too.
+            if ( stopping || h.dead ) return nullptr;
+            h.r = new ring;
+            rings.push_back( h.r );
+            if ( ! flusher.joinable() ) flusher = std::thread( [this] { run(); } );
+        }
+        return h.r;
+    }
+
+    void run() {
+        std::unique_lock< std::mutex > hold( rings_lock );
+        while ( ! stopping ) {
+            wake.wait_for( hold, interval );
+            hold.unlock();
+            flush();
+            hold.lock();
+        }
+    }
+
+    //! @brief Caller holds drain_lock.
+    void drain() {
+        std::vector< ring * > live;
+        {
+            std::lock_guard< std::mutex > hold( rings_lock );
+            live = rings;
+        }
+
+        // Format into one buffer, remembering which stretches belong to which descriptor.
+        text.clear();
+        extents.clear();
+        std::vector< ring * > done;
+        for ( ring *r : live ) {
+            const bool retired = r->retired.load( std::memory_order_acquire );
+            r->drain( [this]( const record &rec ) {
+                const size_t from = text.size();
+                format( text, rec );
+                if ( ! extents.empty() && extents.back().fd == rec.fd
+                     && extents.back().off + extents.back().len == from )
+                    extents.back().len += text.size() - from;
+                else
+                    extents.push_back( { rec.fd, from, text.size() - from } );
+            } );
+            if ( retired ) done.push_back( r );
+        }
+
+        for ( size_t i = 0; i < extents.size(); ) {
+            const int fd = extents[ i ].fd;
+            iov.clear();
+            for ( size_t j = i; j < extents.size(); ++j ) {
+                if ( extents[ j ].fd != fd || extents[ j ].len == 0 ) continue;
+                iov.push_back( { &text[ extents[ j ].off ], extents[ j ].len } );
+                extents[ j ].len = 0;
+            }
+            write_all( fd, iov.data(), (int) iov.size() );
+            while ( i < extents.size() && extents[ i ].len == 0 ) ++i;
+        }
+
+        if ( ! done.empty() ) {
+            std::lock_guard< std::mutex > hold( rings_lock );
+            for ( ring *r : done ) {
+                lost += r->dropped.load( std::memory_order_relaxed );
+                for ( auto &p : rings ) if ( p == r ) { p = rings.back(); break; }
+                rings.pop_back();
+                delete r;
+            }
+        }
+    }
+
+    struct extent {
+        int     fd;
+        size_t  off;
+        size_t  len;
+    };
+
+    std::mutex                 rings_lock;
+    std::vector< ring * >      rings;
+    std::condition_variable    wake;
+    std::thread                flusher;
+    bool                       stopping   { false };
+    uint64_t                   lost       {     0 };
+
+    std::mutex                 drain_lock;
+    std::string                text;
+    std::vector< extent >      extents;
+    std::vector< struct iovec > iov;
+};
+
+}
+
+WAX_STOPWATCH_API void push( const record &r ) { _impl::reporter::get().push( r ); }
+
+WAX_STOPWATCH_API void flush() { _impl::reporter::get().flush(); }
+
+WAX_STOPWATCH_API uint64_t dropped() { return _impl::reporter::get().dropped(); }
+
+}
+}
+}
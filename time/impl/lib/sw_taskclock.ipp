@@ -0,0 +1,59 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../sw_taskclock.ipp"
+
+namespace wax {
+namespace _impl {
+namespace taskclock {
+namespace _impl {
+
+WAX_STOPWATCH_API void page::open() noexcept( true ) {
+    close();
+    generation = __atomic_load_n( &forks(), __ATOMIC_RELAXED );
+    static const bool hooked = [] {
+        return ::pthread_atfork( nullptr, nullptr, [] {
+            __atomic_fetch_add( &forks(), 1, __ATOMIC_RELAXED ); } ) == 0; }();
+    if ( ! hooked ) return;
+
+    struct perf_event_attr a;
+    ::memset( &a, 0, sizeof a );
+    a.size   = sizeof a;
+    a.type   = PERF_TYPE_SOFTWARE;
+    a.config = PERF_COUNT_SW_TASK_CLOCK;
+    int fd = (int) ::syscall( SYS_perf_event_open, &a, 0, -1, -1, PERF_FLAG_FD_CLOEXEC );
+    if ( fd < 0 ) {
+        a.exclude_kernel = 1;
+        fd = (int) ::syscall( SYS_perf_event_open, &a, 0, -1, -1, PERF_FLAG_FD_CLOEXEC );
+    }
+    if ( fd < 0 ) return;
+    size = ::sysconf( _SC_PAGESIZE );
+    void *p = ::mmap( nullptr, size, PROT_READ, MAP_SHARED, fd, 0 );
+    // The mapping holds the event open; the descriptor isn't needed.
+    ::close( fd );
+    if ( p == MAP_FAILED ) return;
+    pc = static_cast< const volatile struct perf_event_mmap_page * >( p );
+
+    int64_t ns;
+    if ( ! read_page( pc, ns ) ) {
+        close();
+        return;
+    }
+    origin = syscall_ns() - ns;
+}
+
+WAX_STOPWATCH_API void page::close() noexcept( true ) {
+    if ( pc ) ::munmap( const_cast< struct perf_event_mmap_page * >( pc ), size );
+    pc = nullptr;
+}
+
+}
+}
+}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <cpuid.h>
+#endif
+
+#include "../sw_tsc.ipp"
+
+namespace wax {
+namespace _impl {
+namespace tsc {
+
+namespace _impl {
+
+//! @return True if the counter is safe to use as a wall-clock time source on this machine.
+inline bool invariant() noexcept( true ) {
+#if defined( __x86_64__ ) || defined( __i386__ )
+    unsigned eax, ebx, ecx, edx;
+    // rdtscp is advertised in 0x80000001 EDX[27]; invariant TSC in 0x80000007 EDX[8].
+    if ( ::__get_cpuid_max( 0x80000000, nullptr ) < 0x80000007 ) return false;
+    if ( ! ::__get_cpuid( 0x80000001, &eax, &ebx, &ecx, &edx ) || ! ( edx & ( 1U << 27 ) ) )
+        return false;
+    if ( ! ::__get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx ) ) return false;
+    return edx & ( 1U << 8 );
+#elif defined( __aarch64__ )
+    // The generic timer is architecturally required to run at a constant frequency.
+    return true;
+#else
+    return false;
+#endif
+}
+
+//! @brief Sample the counter and CLOCK_MONOTONIC_RAW at the same instant, as nearly as possible.
+//
+// Takes the tightest of a few bracketing reads so that a preemption between the two clocks
+// doesn't skew the result.
+//
+inline void pair( uint64_t &cyc, int64_t &ns ) noexcept( true ) {
+    uint64_t best = ~0UL;
+    for ( int i = 0; i < 8; ++i ) {
+        const uint64_t before = cycles();
+        const int64_t  t      = raw_ns();
+        const uint64_t after  = cycles();
+        if ( after - before < best ) {
+            best = after - before;
+            cyc  = before + ( after - before ) / 2;
+            ns   = t;
+        }
+    }
+}
+
+WAX_STOPWATCH_API calibration calibrate() noexcept( true ) {
+    calibration c;
+    if ( ! invariant() ) return c;
+
+#if defined( __aarch64__ )
+    uint64_t freq;
+    asm volatile( "mrs %0, cntfrq_el0" : "=r" ( freq ) );
+    if ( freq == 0 ) return c;
+    uint64_t mult = ( 1000000000UL << c.shift ) / freq;
+    pair( c.base_cycles, c.base_ns );
+#else
+    // Spin rather than sleep: the point is to be done quickly and the result only needs to
+    // be good to a few ppm.
+    static constexpr int64_t window_ns = 10000000L;
+    uint64_t end_cycles = 0;
+    int64_t  end_ns     = 0;
+    pair( c.base_cycles, c.base_ns );
+    do {
+        pair( end_cycles, end_ns );
+    } while ( end_ns - c.base_ns < window_ns );
+    if ( end_cycles <= c.base_cycles ) return c;
+    uint64_t mult = ( (unsigned __int128) ( end_ns - c.base_ns ) << c.shift )
+        / ( end_cycles - c.base_cycles );
+#endif
+
+    if ( mult == 0 ) return c;
+    c.mult   = mult;
+    c.usable = true;
+    return c;
+}
+
+}
+
+}
+}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <utility>
+#include "sw_base.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief A stopwatch that can be paused: it times only the stretches between resume and pause.
+//
+//  stopwatch::accumulating< clock::cpu::thread > sw( "crunch", fd );
+//  for ( ... ) {
+//      sw.resume();  crunch();  sw.pause();
+//      wait_for_io();
+//  }
+//
+// Starts running.  Each pause() or resume() is one clock read and adds nothing else; lap(),
+// lap_ns(), lap_corrected() and what goes to the sink or descriptor are the running total.
+// Pausing a paused stopwatch, or resuming a running one, does nothing.
+//
+template <clock::_hw_type clock_type>
+class accumulating : public base< clock_type >
+{
+  public:
+
+    template< typename... args >
+    explicit accumulating( args &&... a )
+        :
+        base< clock_type >( std::forward< args >( a )... ),
+        since( this->started() )
+    {}
+
+    accumulating( const accumulating & ) = delete;
+    accumulating &operator=( const accumulating & ) = delete;
+
+    ~accumulating() {
+        if ( this->reporting() ) this->finish( lap_ns() );
+    }
+
+    //! @brief Stop counting until resume().
+    void pause() noexcept( true ) {
+        if ( ! running ) return;
+        total  += clock::ticks< clock_type >() - since;
+        running = false;
+    }
+
+    //! @brief Start counting again from now.
+    void resume() noexcept( true ) {
+        if ( running ) return;
+        since   = clock::ticks< clock_type >();
+        running = true;
+        ++stretches;
+    }
+
+    bool paused() const noexcept( true ) { return ! running; }
+
+    //! @brief Zero the total and start running from now.
+    //  @return 0 on success, -1 on failure.  Errno set to cause of failure.
+    int reset() noexcept( true ) {
+        const int rc = base< clock_type >::reset();
+        since     = this->started();
+        total     = 0;
+        running   = true;
+        stretches = 1;
+        return rc;
+    }
+
+    //! @return Time counted so far.
+    //  @param Template parameter is the desired resolution of the value returned.
+    template< unsigned divisor = 1UL >
+    float lap() const noexcept( true ) {
+        return clock::to_grain< clock_type >( lap_ns() ) / (float) divisor;
+    }
+
+    //! @return Time counted so far as a std::chrono::duration.
+    template< typename duration >
+    duration lap() const noexcept( true ) {
+        return std::chrono::duration_cast< duration >( std::chrono::nanoseconds( lap_ns() ) );
+    }
+
+    //! @return Time counted so far in whole nanoseconds.
+    int64_t lap_ns() const noexcept( true ) {
+        return clock::to_ns< clock_type >( elapsed_ticks() );
+    }
+
+    //! @return Time counted so far in clock ticks.
+    clock::tick_type elapsed_ticks() const noexcept( true ) {
+        return running ? total + clock::ticks< clock_type >() - since : total;
+    }
+
+    //! @return Time counted so far less overhead_ns() for each stretch run, never less than 0.
+    //  Every stretch costs a reading at each end, as a reset() and lap does.
+    int64_t lap_corrected() const noexcept( true ) {
+        const int64_t ns = lap_ns();
+        const int64_t c  = ns - (int64_t) stretches * this->overhead_ns();
+        return c > 0 ? c : 0;
+    }
+
+  private:
+
+    clock::tick_type  since     { 0 };         //< When it last resumed.
+    clock::tick_type  total     { 0 };         //< Ticks counted up to since.
+    bool              running   { true };
+    uint32_t          stretches { 1 };         //< Since construction or reset(), this one too.
+};
+
+}
+}
+}
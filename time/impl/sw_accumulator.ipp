@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include "sw_sink.ipp"
+#include "sw_thread.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief Count, sum, sum of squares, min and max of a set of timings.
+struct moments {
+    uint64_t  count   { 0 };
+    int64_t   sum     { 0 };
+    double    sumsq   { 0 };
+    int64_t   min     { 0 };
+    int64_t   max     { 0 };
+
+    //! @brief Fold another set into this one.
+    void merge( const moments &o ) noexcept( true ) {
+        if ( o.count == 0 ) return;
+        if ( count == 0 || o.min < min ) min = o.min;
+        if ( count == 0 || o.max > max ) max = o.max;
+        count += o.count;
+        sum   += o.sum;
+        sumsq += o.sumsq;
+    }
+
+    double mean() const noexcept( true ) { return count ? (double) sum / count : 0.0; }
+
+    //! @return Population variance.
+    double variance() const noexcept( true ) {
+        if ( count == 0 ) return 0.0;
+        const double m = mean();
+        const double v = sumsq / count - m * m;
+        return v > 0.0 ? v : 0.0;
+    }
+
+    double stddev() const noexcept( true ) { return std::sqrt( variance() ); }
+};
+
+//! @brief Timing statistics sharded per thread.
+//
+// Each of the first shard_count - 1 live threads owns a cache line to itself and updates it with
+// plain stores under a seqlock: no read-modify-write on anything another core touches.  Threads
+// beyond that share the last shard and take turns on it.  snapshot() sums the shards without
+// stopping anyone, retrying a shard only if its owner was mid-update.
+//
+class accumulator
+{
+  public:
+
+    static constexpr unsigned shard_count = 128;
+
+    accumulator() = default;
+    accumulator( const accumulator & ) = delete;
+    accumulator &operator=( const accumulator & ) = delete;
+
+    //! @brief Add n occurrences of a value in nanoseconds.
+    void record( int64_t ns, uint64_t n = 1 ) noexcept( true ) {
+        const unsigned t = ::wax::_impl::thread::ordinal();
+        if ( __builtin_expect( t < shard_count - 1, 1 ) ) {
+            auto &s = shards[ t ];
+            const uint32_t seq = s.seq.load( std::memory_order_relaxed );
+            s.seq.store( seq + 1, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+            s.add( ns, n );
+            s.seq.store( seq + 2, std::memory_order_release );
+        } else {
+            auto &s = shards[ shard_count - 1 ];
+            uint32_t seq = s.seq.load( std::memory_order_relaxed );
+            while ( ( seq & 1 ) || ! s.seq.compare_exchange_weak( seq, seq + 1,
+                                                                 std::memory_order_acquire ) )
+                seq = s.seq.load( std::memory_order_relaxed );
+            // As above: the odd count has to be visible before any of the data.
+            std::atomic_thread_fence( std::memory_order_release );
+            s.add( ns, n );
+            s.seq.store( seq + 2, std::memory_order_release );
+        }
+    }
+
+    //! @brief Sink interface, for stopwatches constructed against this accumulator.
+    void record( const sample &smp ) noexcept( true ) { record( smp.ns, smp.weight ); }
+
+    //! @return Totals over every shard.
+    moments snapshot() const noexcept( true ) {
+        moments total;
+        for ( const auto &s : shards ) total.merge( s.read() );
+        return total;
+    }
+
+    //! @brief Zero every shard.  Not safe against concurrent writers.
+    void clear() noexcept( true ) {
+        for ( auto &s : shards ) s.zero();
+    }
+
+  private:
+
+    struct alignas( ::wax::_impl::cache_line ) shard {
+        std::atomic< uint32_t >  seq     { 0 };
+        std::atomic< uint64_t >  count   { 0 };
+        std::atomic< int64_t  >  sum     { 0 };
+        std::atomic< double   >  sumsq   { 0 };
+        std::atomic< int64_t  >  min     { std::numeric_limits< int64_t >::max() };
+        std::atomic< int64_t  >  max     { std::numeric_limits< int64_t >::min() };
+
+        // Caller holds the shard, so these are load/store rather than RMW.
+        void add( int64_t ns, uint64_t n ) noexcept( true ) {
+            static constexpr auto r = std::memory_order_relaxed;
+            count.store( count.load( r ) + n, r );
+            sum.store( sum.load( r ) + ns * (int64_t) n, r );
+            sumsq.store( sumsq.load( r ) + (double) ns * ns * n, r );
+            if ( ns < min.load( r ) ) min.store( ns, r );
+            if ( ns > max.load( r ) ) max.store( ns, r );
+        }
+
+        moments read() const noexcept( true ) {
+            static constexpr auto r = std::memory_order_relaxed;
+            moments m;
+            uint32_t before, after;
+            do {
+                before = seq.load( std::memory_order_acquire );
+                m.count = count.load( r );
+                m.sum   = sum.load( r );
+                m.sumsq = sumsq.load( r );
+                m.min   = min.load( r );
+                m.max   = max.load( r );
+                std::atomic_thread_fence( std::memory_order_acquire );
+                after = seq.load( r );
+            } while ( ( before & 1 ) || before != after );
+            if ( m.count == 0 ) m.min = m.max = 0;
+            return m;
+        }
+
+        void zero() noexcept( true ) {
+            static constexpr auto r = std::memory_order_relaxed;
+            count.store( 0, r );
+            sum.store( 0, r );
+            sumsq.store( 0, r );
+            min.store( std::numeric_limits< int64_t >::max(), r );
+            max.store( std::numeric_limits< int64_t >::min(), r );
+        }
+    };
+
+    shard shards[ shard_count ];
+};
+
+}
+}
+}
@@ -1,100 +1,325 @@
 #pragma once
 
+#include <stdint.h>
 #include <time.h>
-#include "sw_res.hpp"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include "sw_clock.ipp"
+#include "sw_format.ipp"
+#include "sw_label.ipp"
+#include "sw_report.ipp"
+#include "sw_sink.ipp"
 
 namespace wax {
 namespace _impl {
 
 namespace clock {
-    using _hw_type = clockid_t;
-    static constexpr     _hw_type real    = CLOCK_REALTIME;
-    namespace cpu {
-        static constexpr _hw_type thread  = CLOCK_THREAD_CPUTIME_ID;
-        static constexpr _hw_type proc    = CLOCK_PROCESS_CPUTIME_ID;
+    //! @brief What a reset() followed by a lap costs on one clock, in nanoseconds.
+    struct cost {
+        int64_t  min;
+        int64_t  median;
+    };
+
+    //! @return The cost of a reset and lap, measured once per process on first use; see
+    //  overhead_at_startup.
+    //
+    // Times back-to-back reads in a tight loop, so this is the best case: warm caches, no
+    // preemption.  The first call takes a few microseconds on vDSO clocks, rather more on the CPU
+    // clocks; make it outside the region being timed.
+    //
+    template< _hw_type clock_type >
+    inline const cost &overhead() noexcept( true ) {
+        static const cost c = []() -> cost {
+            static constexpr unsigned runs = 1001;
+            int64_t d[ runs ];
+            for ( unsigned i = 0; i < 64; ++i ) (void) ticks< clock_type >();
+            for ( auto &x : d ) {
+                const tick_type t = ticks< clock_type >();
+                x = to_ns< clock_type >( ticks< clock_type >() - t );
+            }
+            std::nth_element( d, d + runs / 2, d + runs );
+            return { *std::min_element( d, d + runs ), d[ runs / 2 ] }; }();
+        return c;
     }
+
+    //! @brief Runs overhead<>() during static initialization for each clock whose
+    //  overhead_ns() appears anywhere in the program, so no timed region pays for it.
+    template< _hw_type clock_type >
+    inline const bool overhead_at_startup = ( (void) overhead< clock_type >(), true );
 }
 
 namespace stopwatch {
 
+//! @return The interned name of a clock, for report lines; looked up once per process.
+inline label_id clock_label( clockid_t clock ) {
+    static constexpr clockid_t known[] = {
+        clock::real, clock::monotonic, clock::monotonic_raw, clock::coarse, clock::boottime,
+        clock::cpu::thread, clock::cpu::proc, clock::tsc };
+    static constexpr unsigned count = sizeof known / sizeof known[ 0 ];
+    struct table { label_id id[ count ]; };
+    static const table t = [] {
+        table x;
+        for ( unsigned i = 0; i < count; ++i )
+            x.id[ i ] = label::intern( format::clock_name( known[ i ] ) );
+        return x;
+    }();
+    for ( unsigned i = 0; i < count; ++i )
+        if ( known[ i ] == clock ) return t.id[ i ];
+    return label::intern( format::clock_name( clock ) );
+}
+
 template <clock::_hw_type clock_type>
 class base
 {
   public:
 
-    base()
-        : resolution( []() -> unsigned long {
-                struct timespec grain { 0, 0 };
-                (void) ::clock_getres( clock_type, &grain );
-                return grain.tv_sec * 1000000000UL + grain.tv_nsec; }() )
-    {
+    base() {
         this->reset();
     }
 
-    //! @param fd File descriptor to write final timing.
+    //! @param fd File descriptor to write final timing.  Written and left open by a background
+    //  thread, so it must stay open until a stopwatch::flush() after this stopwatch is done, or
+    //  until the program exits.
     template< typename... other_args >
-    base( const int fd, other_args... args )
+    base( const int fd, other_args &&... args )
         :
-        base( args... )
+        base( std::forward< other_args >( args )... )
     {
         this->fd = fd;
     }
 
-    //! @param label Name for this stopwatch.
+    //! @param label Name for this stopwatch.  Interned before the clock is read, so that neither
+    //  the timing nor what finish() does with it pays for a lookup; kept as text only if the label
+    //  table is full.
+    template< typename... other_args >
+    base( const char *label, other_args &&... args )
+        :
+        base( ::wax::_impl::label::handle::of( label ), std::forward< other_args >( args )... )
+    {
+        if ( ! id ) this->label = label;
+    }
+
+    //! @param label Name for this stopwatch, interned ahead of time; see WAX_STOPWATCH().
     template< typename... other_args >
-    base( const char *label, other_args... args )
+    base( ::wax::_impl::label::handle label, other_args &&... args )
+        :
+        base( std::forward< other_args >( args )... )
+    {
+        this->id = label.id;
+    }
+
+    //! @param sink Where to record the final timing, e.g. a stopwatch::histogram.  Must outlive
+    //  the stopwatch.
+    template< typename sink_type, typename... other_args,
+              typename std::enable_if< is_sink< sink_type >::value, int >::type = 0 >
+    base( sink_type &sink, other_args &&... args )
         :
-        base( args... )
+        base( std::forward< other_args >( args )... )
     {
-        this->label = label;
+        this->sink = sink;
     }
 
     ~base() {
-        if ( fd >= 0 ) {
-            using namespace ::wax::stopwatch;
-            auto f = ::fdopen( fd, "a" );
-            if ( f ) {
-                static constexpr auto dflt_res = res::msec;
-                ::fprintf(
-                    f, "%s: %.3f %s\n",
-                    label ? label : "<anon>", lap<dflt_res>(), res::units( dflt_res ) );
-                ::fclose( f );
-            }
-        }
+        if ( reporting() ) finish( lap_ns() );
     }
 
     //! @brief Reset the clock.
     //  @return 0 on success, -1 on failure.  Errno set to cause of failure.
     int reset() noexcept( true ) {
-        return ::clock_gettime( clock_type, &start );
+        return clock::read< clock_type >( start );
     }
 
-    //! @return Current lap time in microseconds.
+    //! @return Current lap time.
     //  @param Template parameter is the desired resolution of the value returned.
     //
-    // @todo Do something clever with the resolution so that it doesn't report more resolution than
-    // is actually available.
+    // Rounded to a whole number of res(), so a clock with a coarse grain doesn't show digits it
+    // can't know.  On 1 ns clocks that costs nothing.
     //
     template< unsigned divisor = 1UL >
     float lap() const noexcept( true ) {
-        struct timespec stop { start.tv_sec, start.tv_nsec };
-        (void) ::clock_gettime( clock_type, &stop );
-        return ( stop.tv_sec - start.tv_sec ) * 1000000000
-            + ( stop.tv_nsec - start.tv_nsec ) / (float) divisor;
+        return clock::to_grain< clock_type >( lap_ns() ) / (float) divisor;
+    }
+
+    //! @return Current lap time as a std::chrono::duration, e.g.
+    //  lap< std::chrono::microseconds >().
+    template< typename duration >
+    duration lap() const noexcept( true ) {
+        return std::chrono::duration_cast< duration >( std::chrono::nanoseconds( lap_ns() ) );
+    }
+
+    //! @return Current lap time in whole nanoseconds.
+    int64_t lap_ns() const noexcept( true ) {
+        return clock::to_ns< clock_type >( elapsed_ticks() );
+    }
+
+    //! @return Current lap time in clock ticks; see clock::to_ns<>().
+    clock::tick_type elapsed_ticks() const noexcept( true ) {
+        return clock::ticks< clock_type >() - start;
     }
 
     //! @return The label associated with this stopwatch, or nullptr if there is no name;
-    const char * const name() const noexcept( true ) { return this->label; }
+    const char *name() const noexcept( true ) {
+        return label ? label : ::wax::_impl::label::name( id );
+    }
+
+    //! @return The interned label given at construction, or label::none.
+    stopwatch::label_id label_id() const noexcept( true ) { return id; }
+
+    //! @return Current lap time in nanoseconds less overhead_ns(), and never less than 0.
+    int64_t lap_corrected() const noexcept( true ) {
+        const int64_t lap = lap_ns();
+        const int64_t ns  = lap - overhead_ns();
+        return ns > 0 ? ns : 0;
+    }
 
     //! @return The resolution of the stopwatch in nanoseconds.
-    unsigned long res() const noexcept( true ) { return resolution; }
+    unsigned long res() const noexcept( true ) { return clock::resolution< clock_type >(); }
+
+    //! @return The least a reset() and lap has been seen to cost on this clock, in nanoseconds;
+    //  the median is in clock::overhead<>().  Measured at startup.
+    int64_t overhead_ns() const noexcept( true ) {
+        (void) clock::overhead_at_startup< clock_type >;
+        return clock::overhead< clock_type >().min;
+    }
+
+  protected:
+
+    //! @return The sample finish() sends for a final timing of ns, before any extras.
+    sample summary( int64_t ns ) const noexcept( true ) {
+        return sample { label, id, clock_type, clock::timestamp< clock_type >( start ), ns };
+    }
+
+    //! @brief Finish with a timing of ns and any splits within it.
+    void finish( int64_t ns, const split *splits = nullptr, uint32_t count = 0 ) {
+        sample s = summary( ns );
+        s.splits      = splits;
+        s.split_count = count;
+        finish( s );
+    }
+
+    //! @brief Hand s to the sink and its lines to the descriptor, then forget both so that the
+    //  destructor does nothing more.
+    //
+    // The descriptor gets one line for the total, then one indented line per split, per other
+    // clock, per counter, and for what the clocks say together.
+    //
+    void finish( const sample &s ) {
+        namespace report = ::wax::_impl::report;
+        namespace names  = ::wax::_impl::label;
+        if ( sink ) sink( s );
+        if ( fd >= 0 ) {
+            // Records outlive the text they name, so they carry interned ids.
+            report::push( { id, s.ns, clock_type, 0, report::duration, fd } );
+            for ( uint32_t i = 0; i < s.split_count; ++i )
+                report::push( { s.splits[ i ].id, s.splits[ i ].ns,
+                                clock_type, 1, report::duration, fd } );
+            for ( uint32_t i = 1; i < s.reading_count; ++i ) {
+                const reading &r = s.readings[ i ];
+                report::push( { clock_label( r.clock ), r.ns, (int16_t) r.clock, 1,
+                                report::duration, fd } );
+            }
+            for ( uint32_t i = 0; i < s.counter_count; ++i )
+                report::push( { s.counters[ i ].id ? s.counters[ i ].id
+                                                   : names::intern( s.counters[ i ].name ),
+                                (int64_t) s.counters[ i ].value, clock_type, 1, report::count,
+                                fd } );
+            const derived d = derive( s.readings, s.reading_count );
+            if ( d.complete ) {
+                static const names::handle off_cpu     = names::handle::of( "off-cpu" );
+                static const names::handle utilization = names::handle::of( "utilization" );
+                report::push( { off_cpu.id, d.off_cpu_ns, clock_type, 1, report::duration, fd } );
+                report::push( { utilization.id, (int64_t) ( d.utilization * 1e6 ), clock_type, 1,
+                                report::ratio, fd } );
+            }
+        }
+        fd   = -1;
+        sink = sink_ref();
+    }
+
+    //! @brief Forget the descriptor and sink without reporting, so the destructor does nothing.
+    void discard() noexcept( true ) {
+        fd   = -1;
+        sink = sink_ref();
+    }
+
+    //! @return The start time in ticks.
+    clock::tick_type started() const noexcept( true ) { return start; }
+
+    //! @return True if there is a sink or descriptor for finish() to report to.
+    bool reporting() const noexcept( true ) { return fd >= 0 || sink; }
 
   private:
 
     int                  fd           {       -1 };
-    struct timespec      start        {     0, 0 };
+    clock::tick_type     start        {        0 };
     const char          *label        { nullptr  };
-    const unsigned long  resolution   {        1 };
+    stopwatch::label_id  id           {        0 };
+    sink_ref             sink;
+};
+
+//! @brief A stopwatch reduced to its start time.
+//
+// Trivially constructible and copyable, so it can live in arrays and registers.  The price is
+// that it starts out unset and does nothing when it goes out of scope: call reset() first.
+//
+template <clock::_hw_type clock_type>
+class lite
+{
+  public:
+
+    lite() = default;
+
+    //! @param start Start time in ticks of this clock.
+    constexpr explicit lite( clock::tick_type start ) noexcept( true ) : start( start ) {}
+
+    //! @brief Reset the clock.
+    void reset() noexcept( true ) {
+        start = clock::ticks< clock_type >();
+    }
+
+    //! @return Current lap time, rounded to res().
+    //  @param Template parameter is the desired resolution of the value returned.
+    template< unsigned divisor = 1UL >
+    float lap() const noexcept( true ) {
+        return clock::to_grain< clock_type >( lap_ns() ) / (float) divisor;
+    }
+
+    //! @return Current lap time as a std::chrono::duration.
+    template< typename duration >
+    duration lap() const noexcept( true ) {
+        return std::chrono::duration_cast< duration >( std::chrono::nanoseconds( lap_ns() ) );
+    }
+
+    //! @return Current lap time in whole nanoseconds.
+    int64_t lap_ns() const noexcept( true ) {
+        return clock::to_ns< clock_type >( elapsed_ticks() );
+    }
+
+    //! @return Current lap time in clock ticks.
+    clock::tick_type elapsed_ticks() const noexcept( true ) {
+        return clock::ticks< clock_type >() - start;
+    }
+
+    //! @return Current lap time in nanoseconds less overhead_ns(), and never less than 0.
+    int64_t lap_corrected() const noexcept( true ) {
+        const int64_t lap = lap_ns();
+        const int64_t ns  = lap - overhead_ns();
+        return ns > 0 ? ns : 0;
+    }
+
+    //! @return The resolution of the stopwatch in nanoseconds.
+    static unsigned long res() noexcept( true ) { return clock::resolution< clock_type >(); }
+
+    //! @return The least a reset() and lap costs on this clock, in nanoseconds.
+    static int64_t overhead_ns() noexcept( true ) {
+        (void) clock::overhead_at_startup< clock_type >;
+        return clock::overhead< clock_type >().min;
+    }
+
+  private:
+
+    clock::tick_type start;
 };
 
 }
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sw_base.ipp"
+#include "sw_format.ipp"
+#include "sw_label.ipp"
+#include "sw_report.ipp"
+#include "sw_sink.ipp"
+#include "sw_thread.ipp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace chrome
+//  @brief Samples as Chrome trace events, for chrome://tracing and Perfetto, written as they come.
+//
+// Each thread fills a chunk of fixed-size events of its own, publishing each with one release
+// store of the chunk's count.  A background thread wakes every interval, formats what every
+// thread has published since as complete ("X") events and appends it to the file, so even a
+// thread that records rarely shows up as the run goes.  A full chunk is handed over whole and
+// goes back to the pool once written.  The pool has a fixed number of chunks, one per thread
+// and the rest for full ones waiting, so memory stays bounded however long the capture; if the
+// writer falls so far behind that none is free, events are dropped and counted.
+//
+namespace chrome {
+
+//! @brief One sample, before formatting.
+struct event {
+    int64_t                         ts;     //< Start, nanoseconds on the clock.
+    int64_t                         dur;
+    ::wax::_impl::label::id_type    label;
+    uint32_t                        tid;
+    int32_t                         clock;
+    uint32_t                        depth;
+};
+
+//! @brief Append ns as microseconds with three decimals, as the trace format wants.
+inline void micros( std::string &out, int64_t ns ) {
+    char buf[ 24 ], *p = buf;
+    if ( ns < 0 ) {
+        *p++ = '-';
+        ns   = -ns;
+    }
+    p = std::to_chars( p, buf + sizeof buf, ns / 1000 ).ptr;
+    const int rem = (int) ( ns % 1000 );
+    *p++ = '.';
+    *p++ = (char) ( '0' + rem / 100 );
+    *p++ = (char) ( '0' + rem / 10 % 10 );
+    *p++ = (char) ( '0' + rem % 10 );
+    out.append( buf, p - buf );
+}
+
+//! @brief Append s as the body of a JSON string, dropping control characters.
+inline void quoted( std::string &out, const char *s ) {
+    for ( ; *s; ++s ) {
+        if ( *s == '"' || *s == '\\' ) out += '\\';
+        if ( (unsigned char) *s >= 0x20 ) out += *s;
+    }
+}
+
+//! @brief Writer: a stopwatch sink streaming every sample to a trace file.
+//
+// Set up by the constructor; if that failed is_open() is false, errno says why, and samples are
+// discarded.  CPU-time clocks have no timeline and are left out.  The file is valid JSON once
+// closed; a capture cut short is still accepted by both viewers.
+//
+class writer
+{
+  public:
+
+    static constexpr unsigned chunk_events = 4096;
+    static constexpr unsigned lane_count   = 128;
+
+    //! @param path       File to create or truncate.
+    //  @param max_chunks Chunks in the pool, each of chunk_events events (128 KB), made as
+    //                    needed; a thread holds one while it records, the writer the rest until
+    //                    written.  At least lane_count.
+    //  @param interval   Time between writes of what has been recorded.
+    explicit writer( const char *path, unsigned max_chunks = 2 * lane_count,
+                     std::chrono::milliseconds interval = std::chrono::milliseconds( 50 ) )
+        :
+        limit( max_chunks > lane_count ? max_chunks : lane_count ),
+        pid( (uint32_t) ::getpid() )
+    {
+        fd = ::open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+        if ( fd < 0 ) return;
+        const std::string head = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        write( head );
+        flusher = std::thread( [ this, interval ] { run( interval ); } );
+    }
+
+    writer( const writer & ) = delete;
+    writer &operator=( const writer & ) = delete;
+
+    ~writer() { close(); }
+
+    bool is_open() const noexcept( true ) { return fd >= 0; }
+
+    //! @return Events dropped because no chunk was free.
+    uint64_t dropped() const noexcept( true ) { return lost.load( std::memory_order_relaxed ); }
+
+    //! @brief Write everything, end the JSON and close the file.  No thread may still record.
+    void close() {
+        if ( fd < 0 ) return;
+        {
+            std::lock_guard< std::mutex > hold( lock );
+            stopping = true;
+            for ( auto &l : lanes )
+                if ( chunk *c = l.open.load( std::memory_order_acquire ) ) {
+                    ready.push_back( c );
+                    l.open.store( nullptr, std::memory_order_relaxed );
+                }
+        }
+        wake.notify_all();
+        flusher.join();
+        drain();
+        write( std::string( "\n]}\n" ) );
+        ::close( fd );
+        fd = -1;
+        for ( chunk *c : free ) delete c;
+        free.clear();
+    }
+
+    //! @brief Sink interface.  A few stores; a lock once per chunk.  No thread may record once
+    //  close() has begun.
+    void record( const ::wax::_impl::stopwatch::sample &s ) {
+        if ( fd < 0 || s.clock == CLOCK_THREAD_CPUTIME_ID || s.clock == CLOCK_PROCESS_CPUTIME_ID )
+            return;
+        const event e { s.start, s.ns, s.id ? s.id : ::wax::_impl::label::intern( s.label ),
+                        ::wax::_impl::thread::id(), (int32_t) s.clock, s.depth };
+        const unsigned t = ::wax::_impl::thread::ordinal();
+        if ( __builtin_expect( t < lane_count - 1, 1 ) ) {
+            add( lanes[ t ], e );
+        } else {
+            std::lock_guard< std::mutex > hold( shared_lane );
+            add( lanes[ lane_count - 1 ], e );
+        }
+    }
+
+  private:
+
+    struct chunk {
+        std::atomic< unsigned >  used       { 0 };     //< Events published by the recorder.
+        unsigned                 formatted  { 0 };     //< Events written; flusher only.
+        event                    events[ chunk_events ];
+    };
+
+    struct alignas( ::wax::_impl::cache_line ) lane {
+        std::atomic< chunk * >   open       { nullptr };
+    };
+
+    void add( lane &l, const event &e ) {
+        chunk   *c = l.open.load( std::memory_order_relaxed );
+        unsigned n = c ? c->used.load( std::memory_order_relaxed ) : chunk_events;
+        if ( __builtin_expect( n == chunk_events, 0 ) ) {
+            c = swap( c );
+            l.open.store( c, std::memory_order_release );
+            if ( ! c ) {
+                lost.fetch_add( 1, std::memory_order_relaxed );
+                return;
+            }
+            n = 0;
+        }
+        c->events[ n ] = e;
+        c->used.store( n + 1, std::memory_order_release );
+    }
+
+    //! @return An empty chunk for a full one, or nullptr if the pool is exhausted.
+    chunk *swap( chunk *full ) {
+        chunk *next = nullptr;
+        {
+            std::lock_guard< std::mutex > hold( lock );
+            if ( full ) ready.push_back( full );
+            if ( ! free.empty() ) {
+                next = free.back();
+                free.pop_back();
+            } else if ( made < limit ) {
+                ++made;
+                next = new chunk;
+            }
+        }
+        if ( full ) wake.notify_one();
+        return next;
+    }
+
+    void run( std::chrono::milliseconds interval ) {
+        std::unique_lock< std::mutex > hold( lock );
+        while ( ! stopping ) {
+            wake.wait_for( hold, interval );
+            hold.unlock();
+            drain();
+            hold.lock();
+        }
+    }
+
+    //! @brief Format and write everything published, then return full chunks to the pool.
+    //
+    // Only this thread recycles chunks, and it reads the open ones before the full ones, so a
+    // chunk seen through a lane can't be reused before it is done with.  Each chunk's own count
+    // of what has been written means nothing comes out twice, however it was reached.
+    //
+    void drain() {
+        text.clear();
+        for ( auto &l : lanes )
+            if ( chunk *c = l.open.load( std::memory_order_acquire ) ) publish( *c );
+        std::vector< chunk * > batch;
+        {
+            std::lock_guard< std::mutex > hold( lock );
+            batch.swap( ready );
+        }
+        for ( chunk *c : batch ) {
+            publish( *c );
+            c->used.store( 0, std::memory_order_relaxed );
+            c->formatted = 0;
+        }
+        if ( ! text.empty() ) write( text );
+        if ( batch.empty() ) return;
+        std::lock_guard< std::mutex > hold( lock );
+        free.insert( free.end(), batch.begin(), batch.end() );
+    }
+
+    void publish( chunk &c ) {
+        const unsigned n = c.used.load( std::memory_order_acquire );
+        for ( ; c.formatted < n; ++c.formatted ) format( c.events[ c.formatted ] );
+    }
+
+    void format( const event &e ) {
+        const char *name = ::wax::_impl::label::name( e.label );
+        text += any ? ",\n{\"ph\":\"X\",\"name\":\"" : "\n{\"ph\":\"X\",\"name\":\"";
+        any = true;
+        quoted( text, name ? name : "<anon>" );
+        text += "\",\"cat\":\"";
+        text += ::wax::_impl::format::clock_name( e.clock );
+        char num[ 16 ];
+        text += "\",\"pid\":";
+        text.append( num, std::to_chars( num, num + sizeof num, pid ).ptr - num );
+        text += ",\"tid\":";
+        text.append( num, std::to_chars( num, num + sizeof num, e.tid ).ptr - num );
+        text += ",\"ts\":";
+        micros( text, e.ts );
+        text += ",\"dur\":";
+        micros( text, e.dur );
+        if ( e.depth ) {
+            text += ",\"args\":{\"depth\":";
+            text.append( num, std::to_chars( num, num + sizeof num, e.depth ).ptr - num );
+            text += '}';
+        }
+        text += '}';
+    }
+
+    void write( const std::string &s ) {
+        struct iovec iov { const_cast< char * >( s.data() ), s.size() };
+        ::wax::_impl::report::_impl::write_all( fd, &iov, 1 );
+    }
+
+    int                        fd          { -1 };
+    const unsigned             limit;
+    const uint32_t             pid;
+    lane                       lanes[ lane_count ];
+    std::mutex                 shared_lane;
+    std::atomic< uint64_t >    lost        { 0 };
+
+    std::mutex                 lock;
+    std::condition_variable    wake;
+    std::vector< chunk * >     ready;
+    std::vector< chunk * >     free;
+    unsigned                   made        { 0 };
+    bool                       stopping    { false };
+    std::thread                flusher;
+
+    // Flusher only.
+    std::string                text;
+    bool                       any         { false };
+};
+
+}
+}
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include "sw_res.hpp"
+#include "sw_taskclock.ipp"
+#include "sw_tsc.ipp"
+
+namespace wax {
+namespace _impl {
+
+namespace clock {
+    using _hw_type = clockid_t;
+    static constexpr     _hw_type real          = CLOCK_REALTIME;
+    static constexpr     _hw_type monotonic     = CLOCK_MONOTONIC;
+    static constexpr     _hw_type monotonic_raw = CLOCK_MONOTONIC_RAW;
+    static constexpr     _hw_type coarse        = CLOCK_MONOTONIC_COARSE;
+    static constexpr     _hw_type boottime      = CLOCK_BOOTTIME;
+    namespace cpu {
+        static constexpr _hw_type thread        = CLOCK_THREAD_CPUTIME_ID;
+        static constexpr _hw_type proc          = CLOCK_PROCESS_CPUTIME_ID;
+    }
+
+    // Not a kernel clock id.  Ids past MAX_CLOCKS are rejected by clock_gettime(2), so this can't
+    // collide with a real one.
+    static constexpr     _hw_type tsc           = 0x7453;
+
+    //! @brief clock_gettime() dispatched on clock type at compile time.
+    template< _hw_type clock_type >
+    inline int gettime( struct timespec *ts ) noexcept( true ) {
+        return ::clock_gettime( clock_type, ts );
+    }
+
+    template<>
+    inline int gettime< tsc >( struct timespec *ts ) noexcept( true ) {
+        return ::wax::_impl::tsc::gettime( ts );
+    }
+
+    // Without a system call where the kernel allows; see taskclock.
+    template<>
+    inline int gettime< cpu::thread >( struct timespec *ts ) noexcept( true ) {
+        return ::wax::_impl::taskclock::gettime( ts );
+    }
+
+    //! @brief clock_getres() dispatched on clock type at compile time.
+    template< _hw_type clock_type >
+    inline int getres( struct timespec *res ) noexcept( true ) {
+        return ::clock_getres( clock_type, res );
+    }
+
+    template<>
+    inline int getres< tsc >( struct timespec *res ) noexcept( true ) {
+        return ::wax::_impl::tsc::getres( res );
+    }
+
+    //! @brief Raw clock reading.
+    //
+    // Nanoseconds for the kernel clocks, cycles for tsc.  Differences between two readings of the
+    // same clock convert with to_ns<>(), so that conversion can wait until off the hot path.
+    //
+    using tick_type = int64_t;
+
+    //! @brief Read the clock in ticks.
+    //  @return 0 on success, -1 on failure.  Errno set to cause of failure.
+    template< _hw_type clock_type >
+    inline int read( tick_type &t ) noexcept( true ) {
+        struct timespec ts { 0, 0 };
+        const int rc = gettime< clock_type >( &ts );
+        t = ts.tv_sec * 1000000000L + ts.tv_nsec;
+        return rc;
+    }
+
+    template<>
+    inline int read< tsc >( tick_type &t ) noexcept( true ) {
+        t = ::wax::_impl::tsc::ticks();
+        return 0;
+    }
+
+    template<>
+    inline int read< cpu::thread >( tick_type &t ) noexcept( true ) {
+        t = ::wax::_impl::taskclock::now();
+        return 0;
+    }
+
+    //! @brief Pay a clock's first-read setup on this thread now, rather than inside an interval.
+    //
+    // tsc calibrates once per process and cpu::thread opens its task-clock page once per thread;
+    // the kernel clocks need nothing.
+    //
+    template< _hw_type clock_type >
+    inline void warm() noexcept( true ) {}
+
+    template<>
+    inline void warm< tsc >() noexcept( true ) {
+        (void) ::wax::_impl::tsc::calibrated();
+    }
+
+    template<>
+    inline void warm< cpu::thread >() noexcept( true ) {
+        (void) ::wax::_impl::taskclock::direct();
+    }
+
+    //! @return The clock in ticks.
+    template< _hw_type clock_type >
+    inline tick_type ticks() noexcept( true ) {
+        tick_type t { 0 };
+        (void) read< clock_type >( t );
+        return t;
+    }
+
+    //! @return Nanoseconds in a span of ticks.
+    template< _hw_type clock_type >
+    inline int64_t to_ns( tick_type span ) noexcept( true ) {
+        return span;
+    }
+
+    template<>
+    inline int64_t to_ns< tsc >( tick_type span ) noexcept( true ) {
+        return ::wax::_impl::tsc::elapsed_ns( span );
+    }
+
+    //! @return Nanoseconds since the clock's epoch for a single reading in ticks.
+    template< _hw_type clock_type >
+    inline int64_t timestamp( tick_type t ) noexcept( true ) {
+        return t;
+    }
+
+    template<>
+    inline int64_t timestamp< tsc >( tick_type t ) noexcept( true ) {
+        return ::wax::_impl::tsc::timestamp( t );
+    }
+
+    //! @return The current time of the clock in nanoseconds, or 0 if it can't be read.
+    template< _hw_type clock_type >
+    inline int64_t now() noexcept( true ) {
+        struct timespec ts { 0, 0 };
+        (void) gettime< clock_type >( &ts );
+        return ts.tv_sec * 1000000000L + ts.tv_nsec;
+    }
+
+    template<>
+    inline int64_t now< tsc >() noexcept( true ) {
+        return ::wax::_impl::tsc::now();
+    }
+
+    //! @return The resolution of the clock in nanoseconds, queried once per process.
+    template< _hw_type clock_type >
+    inline unsigned long resolution() noexcept( true ) {
+        static const unsigned long grain = []() -> unsigned long {
+            struct timespec g { 0, 0 };
+            (void) getres< clock_type >( &g );
+            return g.tv_sec * 1000000000UL + g.tv_nsec; }();
+        return grain;
+    }
+
+    //! @return ns rounded to the nearest multiple of the clock's resolution.
+    template< _hw_type clock_type >
+    inline int64_t to_grain( int64_t ns ) noexcept( true ) {
+        const int64_t g = (int64_t) resolution< clock_type >();
+        if ( __builtin_expect( g <= 1, 1 ) ) return ns;
+        return ( ns + ( ns < 0 ? -g : g ) / 2 ) / g * g;
+    }
+}
+
+}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+//! @file sw_config.hpp
+//  @brief Header-only or compiled: where the library's cold code lives.
+//
+//  By default everything is inline in the headers.  Define WAX_STOPWATCH_LIBRARY in every
+//  translation unit, as the wax::stopwatch CMake target does, and link libwax_stopwatch: the
+//  label table, the report thread and the clock calibration are then compiled once, into the
+//  library, and the headers hold only their declarations and the hot paths.  Mixing the two
+//  modes in one program is an ODR violation.
+//
+#if defined( WAX_STOPWATCH_LIBRARY )
+#define WAX_STOPWATCH_API
+#else
+#define WAX_STOPWATCH_API inline
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include "sw_base.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief Stand-in for every stopwatch when WAX_STOPWATCH_DISABLE is defined.
+//
+// Takes any constructor arguments and does nothing with them; every reading is zero.  An empty
+// class with inline no-op members, so instrumented code compiles to what it would be without
+// the instrumentation.
+//
+template <clock::_hw_type clock_type>
+class disabled
+{
+  public:
+
+    template< typename... args >
+    constexpr explicit disabled( args &&... ) noexcept( true ) {}
+
+    int reset() noexcept( true ) { return 0; }
+
+    template< unsigned divisor = 1UL >
+    constexpr float lap() const noexcept( true ) { return 0; }
+
+    template< typename duration >
+    constexpr duration lap() const noexcept( true ) { return duration::zero(); }
+
+    constexpr int64_t           lap_ns()        const noexcept( true ) { return 0; }
+    constexpr int64_t           lap_corrected() const noexcept( true ) { return 0; }
+    constexpr clock::tick_type  elapsed_ticks() const noexcept( true ) { return 0; }
+    constexpr const char       *name()          const noexcept( true ) { return nullptr; }
+    constexpr stopwatch::label_id label_id()    const noexcept( true ) { return 0; }
+    constexpr unsigned long     res()           const noexcept( true ) { return 1; }
+    constexpr int64_t           overhead_ns()   const noexcept( true ) { return 0; }
+
+    // span
+    constexpr uint32_t id()        const noexcept( true ) { return 0; }
+    constexpr uint32_t parent_id() const noexcept( true ) { return 0; }
+    constexpr uint32_t depth()     const noexcept( true ) { return 0; }
+    static void report( int ) noexcept( true ) {}
+
+    // splits
+    template< typename label_type >
+    void split( label_type ) noexcept( true ) {}
+    constexpr uint32_t size()      const noexcept( true ) { return 0; }
+
+    // accumulating
+    void pause()  noexcept( true ) {}
+    void resume() noexcept( true ) {}
+    constexpr bool paused() const noexcept( true ) { return false; }
+
+    // multi
+    constexpr derived metrics() const noexcept( true ) { return derived {}; }
+
+    // task
+    void suspend()  noexcept( true ) {}
+    void complete() noexcept( true ) {}
+    constexpr int64_t  active_ns() const noexcept( true ) { return 0; }
+    constexpr int64_t  cpu_ns()    const noexcept( true ) { return 0; }
+    constexpr uint64_t resumes()   const noexcept( true ) { return 0; }
+
+    // sampled
+    constexpr bool timed() const noexcept( true ) { return false; }
+
+    // slow
+    void context( uint64_t ) noexcept( true ) {}
+
+    // perf
+    constexpr bool available() const noexcept( true ) { return false; }
+    void counts( uint64_t * ) const noexcept( true ) {}
+};
+
+//! @brief kind< clock_type >, or disabled< clock_type > under WAX_STOPWATCH_DISABLE.
+#if defined( WAX_STOPWATCH_DISABLE )
+template< template< clock::_hw_type > class kind, clock::_hw_type clock_type >
+using enabled = disabled< clock_type >;
+#else
+template< template< clock::_hw_type > class kind, clock::_hw_type clock_type >
+using enabled = kind< clock_type >;
+#endif
+
+}
+}
+}
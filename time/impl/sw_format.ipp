@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <charconv>
+#include "sw_res.hpp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace format
+//  @brief Durations as text, in a unit suited to their size and without false precision.
+//
+// No allocation, no locale and no printf, so it can run for every line the reporter writes.
+//
+namespace format {
+
+//! @brief Longest text duration() writes: sign, 19 digits, point, space, unit.
+static constexpr size_t max_duration = 32;
+
+//! @return The largest power of ten no bigger than n, or 1.
+constexpr uint64_t floor_pow10( uint64_t n ) noexcept( true ) {
+    uint64_t p = 1;
+    while ( p <= n / 10 ) p *= 10;
+    return p;
+}
+
+namespace _impl {
+
+//! @brief Write a magnitude in ns as a decimal in unit, with its last digit at step ns.
+inline char *fixed( char *out, char *end, uint64_t mag, uint64_t unit, uint64_t step,
+                    const char *sfx ) noexcept( true ) {
+    if ( step > 1 ) mag = ( mag + step / 2 ) / step * step;
+    out = std::to_chars( out, end, mag / unit ).ptr;
+    if ( step < unit ) {
+        *out++ = '.';
+        // Leading zeros of the fraction are kept: pad to the width step/unit implies.
+        uint64_t frac = mag % unit / step;
+        char     digits[ 20 ];
+        char    *d = digits + sizeof digits;
+        for ( uint64_t w = unit / step; w > 1; w /= 10, frac /= 10 ) *--d = '0' + frac % 10;
+        const size_t n = digits + sizeof digits - d;
+        ::memcpy( out, d, n );
+        out += n;
+    }
+    *out++ = ' ';
+    const size_t n = ::strlen( sfx );
+    ::memcpy( out, sfx, n );
+    return out + n;
+}
+
+}
+
+//! @brief Write ns as text, e.g. "12.34 μs".
+//
+// The unit is the largest one from res::_impl::suffix_table that the value, or the grain if
+// that is bigger, reaches.  The last digit is the largest power of ten not above the grain, so
+// a 1 ns clock shows "1.234567 ms" and a 4 ms clock shows "12 ms".  Rounded to that digit
+// before the unit is picked, so 999.9 μs to the microsecond is "1.000 ms", not "1000 μs".
+//
+//  @param out   At least max_duration chars.
+//  @param grain Resolution of the clock in nanoseconds.
+//  @return One past the last char written.  No terminating nul.
+//
+inline char *duration( char *out, int64_t ns, unsigned long grain ) noexcept( true ) {
+    char *const    end = out + max_duration;
+    const uint64_t mag = ns < 0 ? 0 - (uint64_t) ns : (uint64_t) ns;
+    if ( ns < 0 ) *out++ = '-';
+
+    const uint64_t step  = floor_pow10( grain ? grain : 1 );
+    const uint64_t round = step > 1 && mag <= UINT64_MAX - step / 2
+                           ? ( mag + step / 2 ) / step * step : mag;
+    const uint64_t reach = round > step ? round : step;
+    for ( const auto &s : ::wax::stopwatch::res::_impl::suffix_table )
+        if ( reach >= s.first ) return _impl::fixed( out, end, mag, s.first, step, s.second );
+    return _impl::fixed( out, end, mag, 1, step, "ns" );
+}
+
+//! @brief As above, always in unit, e.g. duration< res::usec >().  Unit and suffix are fixed
+//  at compile time.  Digits finer than unit are shown only as far as the grain allows.
+template< unsigned unit >
+inline char *duration( char *out, int64_t ns, unsigned long grain ) noexcept( true ) {
+    static constexpr const char *sfx = ::wax::stopwatch::res::units< unit >();
+    static_assert( sfx[ 0 ] != 0, "unit must be one of stopwatch::res" );
+    char *const    end = out + max_duration;
+    const uint64_t mag = ns < 0 ? 0 - (uint64_t) ns : (uint64_t) ns;
+    if ( ns < 0 ) *out++ = '-';
+    return _impl::fixed( out, end, mag, unit, floor_pow10( grain ? grain : 1 ), sfx );
+}
+
+//! @brief Write parts per million as a percentage to one decimal place, e.g. "82.5 %".
+//  @param out At least max_duration chars.
+//  @return One past the last char written.  No terminating nul.
+inline char *percent( char *out, int64_t ppm ) noexcept( true ) {
+    char *const    end = out + max_duration;
+    const uint64_t mag = ( ( ppm < 0 ? 0 - (uint64_t) ppm : (uint64_t) ppm ) + 500 ) / 1000;
+    if ( ppm < 0 ) *out++ = '-';
+    out = std::to_chars( out, end, mag / 10 ).ptr;
+    *out++ = '.';
+    *out++ = '0' + mag % 10;
+    *out++ = ' ';
+    *out++ = '%';
+    return out;
+}
+
+//! @return A short name for a clock id, as the stopwatch aliases spell it.
+inline const char *clock_name( clockid_t clock ) noexcept( true ) {
+    switch ( clock ) {
+        case CLOCK_REALTIME:            return "real";
+        case CLOCK_MONOTONIC:           return "monotonic";
+        case CLOCK_MONOTONIC_RAW:       return "monotonic_raw";
+        case CLOCK_MONOTONIC_COARSE:    return "coarse";
+        case CLOCK_BOOTTIME:            return "boottime";
+        case CLOCK_THREAD_CPUTIME_ID:   return "cpu::thread";
+        case CLOCK_PROCESS_CPUTIME_ID:  return "cpu::proc";
+        case 0x7453:                    return "tsc";
+        default:                        return "clock";
+    }
+}
+
+//! @return The resolution of a clock by id, in nanoseconds; 1 for clocks clock_getres(2) doesn't
+//  know.  Looked up once per process.
+inline unsigned long grain( clockid_t clock ) noexcept( true ) {
+    static constexpr int known = 16;
+    struct table { unsigned long g[ known ]; };
+    static const table t = []() {
+        table x;
+        for ( int c = 0; c < known; ++c ) {
+            struct timespec r { 0, 0 };
+            x.g[ c ] = ::clock_getres( c, &r ) == 0 ? r.tv_sec * 1000000000UL + r.tv_nsec : 1;
+            if ( x.g[ c ] == 0 ) x.g[ c ] = 1;
+        }
+        return x; }();
+    return clock >= 0 && clock < known ? t.g[ clock ] : 1;
+}
+
+}
+}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "sw_sink.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief Log-linear latency histogram.
+//
+// Values below 256 ns get a bucket each; above that every power of two is split into 128
+// buckets, so any recorded value is reported to within 1/128 (0.8%).  The top bucket ends at
+// 2^44 ns, a little under five hours, and larger values are counted there.
+//
+// Recording is one relaxed increment.  Readers walk the buckets without stopping writers, so a
+// report taken under load may straddle a few in-flight samples.  At about 38 KB apiece these are
+// meant to be long-lived: one per thing being measured, not one per stopwatch.
+//
+class histogram
+{
+  public:
+
+    static constexpr unsigned  sub_bits      = 7;
+    static constexpr unsigned  max_bits      = 44;
+    static constexpr uint64_t  max_trackable = ( 1UL << max_bits ) - 1;
+    static constexpr unsigned  bucket_count  = ( max_bits - sub_bits + 1 ) << sub_bits;
+
+    histogram() = default;
+    histogram( const histogram & ) = delete;
+    histogram &operator=( const histogram & ) = delete;
+
+    //! @return Bucket holding the value ns.
+    static constexpr unsigned index( int64_t ns ) noexcept( true ) {
+        const uint64_t v     = ns < 0 ? 0 : (uint64_t) ns > max_trackable ? max_trackable : ns;
+        const unsigned msb   = 63 - __builtin_clzl( v | 1 );
+        const unsigned shift = msb > sub_bits ? msb - sub_bits : 0;
+        return ( shift << sub_bits ) + ( v >> shift );
+    }
+
+    //! @return Smallest value counted in a bucket.
+    static constexpr int64_t lowest( unsigned i ) noexcept( true ) {
+        const unsigned shift = ( i >> sub_bits ? i >> sub_bits : 1 ) - 1;
+        return (int64_t) ( i - ( shift << sub_bits ) ) << shift;
+    }
+
+    //! @return Largest value counted in a bucket.
+    static constexpr int64_t highest( unsigned i ) noexcept( true ) {
+        const unsigned shift = ( i >> sub_bits ? i >> sub_bits : 1 ) - 1;
+        return lowest( i ) + ( 1L << shift ) - 1;
+    }
+
+    //! @brief Count n occurrences of a value in nanoseconds.
+    void record( int64_t ns, uint64_t n = 1 ) noexcept( true ) {
+        counts[ index( ns ) ].fetch_add( n, std::memory_order_relaxed );
+    }
+
+    //! @brief Sink interface, for stopwatches constructed against this histogram.
+    void record( const sample &s ) noexcept( true ) { record( s.ns, s.weight ); }
+
+    //! @brief Add another histogram's counts to this one.
+    void merge( const histogram &other ) noexcept( true ) {
+        for ( unsigned i = 0; i < bucket_count; ++i ) {
+            const uint64_t n = other.counts[ i ].load( std::memory_order_relaxed );
+            if ( n ) counts[ i ].fetch_add( n, std::memory_order_relaxed );
+        }
+    }
+
+    //! @brief Forget all recorded values.
+    void clear() noexcept( true ) {
+        for ( auto &c : counts ) c.store( 0, std::memory_order_relaxed );
+    }
+
+    //! @return Number of values recorded.
+    uint64_t count() const noexcept( true ) {
+        uint64_t total = 0;
+        for ( const auto &c : counts ) total += c.load( std::memory_order_relaxed );
+        return total;
+    }
+
+    //! @return Count in one bucket.
+    uint64_t at( unsigned i ) const noexcept( true ) {
+        return counts[ i ].load( std::memory_order_relaxed );
+    }
+
+    //! @return The value at or below which pct percent of recorded values fall, or 0 if empty.
+    //
+    // Reported as the top of its bucket, so tails are never understated.
+    //
+    int64_t percentile( double pct ) const noexcept( true ) {
+        const uint64_t total = count();
+        if ( total == 0 ) return 0;
+        uint64_t rank = (uint64_t) ( pct / 100.0 * total + 0.5 );
+        if ( rank < 1 ) rank = 1;
+        if ( rank > total ) rank = total;
+        uint64_t seen = 0;
+        for ( unsigned i = 0; i < bucket_count; ++i ) {
+            seen += counts[ i ].load( std::memory_order_relaxed );
+            if ( seen >= rank ) return highest( i );
+        }
+        return highest( bucket_count - 1 );
+    }
+
+    int64_t p50()  const noexcept( true ) { return percentile( 50.0 ); }
+    int64_t p99()  const noexcept( true ) { return percentile( 99.0 ); }
+    int64_t p999() const noexcept( true ) { return percentile( 99.9 ); }
+
+    //! @return Lower bound of the smallest value recorded, or 0 if empty.
+    int64_t min() const noexcept( true ) {
+        for ( unsigned i = 0; i < bucket_count; ++i )
+            if ( counts[ i ].load( std::memory_order_relaxed ) ) return lowest( i );
+        return 0;
+    }
+
+    //! @return Upper bound of the largest value recorded, or 0 if empty.
+    int64_t max() const noexcept( true ) {
+        for ( unsigned i = bucket_count; i-- > 0; )
+            if ( counts[ i ].load( std::memory_order_relaxed ) ) return highest( i );
+        return 0;
+    }
+
+  private:
+
+    std::atomic< uint64_t > counts[ bucket_count ] {};
+};
+
+}
+}
+}
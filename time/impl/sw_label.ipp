@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include "sw_config.hpp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace label
+//  @brief Process-wide interning of stopwatch names into small dense ids.
+//
+// Ids start at 1 and never change or get reused; 0 means "no label".  The same text interns to
+// the same id from any pointer, and a buffer reused for other text gets the other text's id.
+// Looking up text seen before hashes and compares it, lock-free; only the first sight of each
+// text takes a lock.  WAX_STOPWATCH() labels skip even that, being interned once at startup.
+//
+namespace label {
+
+using id_type = uint32_t;
+
+static constexpr id_type none = 0;
+
+//! @brief Ids handed out before the table is full.
+static constexpr id_type max_ids = 1U << 16;
+
+//! @return The id for a name, interning it on first use.  none for nullptr, or if the table is
+//  full.
+WAX_STOPWATCH_API id_type intern( const char *s );
+
+//! @return The name for an id, or nullptr.
+WAX_STOPWATCH_API const char *name( id_type id ) noexcept( true );
+
+//! @return The highest id handed out so far.  Every id from 1 up to it has a name.
+WAX_STOPWATCH_API id_type last() noexcept( true );
+
+//! @brief An interned label: what a stopwatch carries instead of its name.
+struct handle {
+    id_type id { none };
+
+    //! @return The handle for a name, interning it now.
+    static handle of( const char *s ) { return handle { intern( s ) }; }
+
+    const char *name() const noexcept( true ) { return label::name( id ); }
+};
+
+//! @brief One label registered during static initialization, per tag type.
+//
+// The tag supplies text(); see WAX_STOPWATCH().  Reading value is a load from a global, with no
+// guard and no lookup.
+//
+template< typename tag >
+struct registered {
+    static const handle value;
+};
+
+template< typename tag >
+const handle registered< tag >::value { intern( tag::text() ) };
+
+}
+}
+}
+
+#if ! defined( WAX_STOPWATCH_LIBRARY )
+#include "lib/sw_label.ipp"
+#endif
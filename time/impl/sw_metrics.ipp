@@ -0,0 +1,399 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "sw_accumulator.ipp"
+#include "sw_histogram.ipp"
+#include "sw_label.ipp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace metrics
+//  @brief Histograms and accumulators registered under labels, exported as OpenMetrics text.
+//
+// Registration is rare and takes a lock.  An export holds the same lock while it walks the
+// table, so whatever it reads stays registered, and so alive, until it is done; it reads each
+// histogram and accumulator the way their own readers do, so writers are never held up by a
+// scrape.  Removal takes the lock too, and a metric removes itself when destroyed.
+//
+namespace metrics {
+
+using label_id = ::wax::_impl::label::id_type;
+
+class registry
+{
+  public:
+
+    static constexpr unsigned max_entries = 4096;
+
+    struct entry {
+        label_id                                      id    {       0 };
+        const ::wax::_impl::stopwatch::histogram     *hist  { nullptr };
+        const ::wax::_impl::stopwatch::accumulator   *acc   { nullptr };
+    };
+
+    //! @return The process-wide registry.  Never destroyed.
+    static registry &get() {
+        static registry *r = new registry;
+        return *r;
+    }
+
+    //! @return False if the table is full.
+    bool add( label_id id, const ::wax::_impl::stopwatch::histogram *h,
+              const ::wax::_impl::stopwatch::accumulator *a ) {
+        std::lock_guard< std::mutex > hold( lock );
+        unsigned i = 0;
+        while ( i < used && entries[ i ].id != id ) ++i;
+        if ( i == used ) {
+            if ( used == max_entries ) return false;
+            entries[ used++ ].id = id;
+        }
+        if ( h ) entries[ i ].hist = h;
+        if ( a ) entries[ i ].acc  = a;
+        return true;
+    }
+
+    //! @brief Forget h and a wherever they are registered, e.g. before they are destroyed.
+    //  Waits for an export in progress.  The labels stay, with nothing under them.
+    void remove( const ::wax::_impl::stopwatch::histogram *h,
+                 const ::wax::_impl::stopwatch::accumulator *a ) {
+        std::lock_guard< std::mutex > hold( lock );
+        for ( unsigned i = 0; i < used; ++i ) {
+            if ( h && entries[ i ].hist == h ) entries[ i ].hist = nullptr;
+            if ( a && entries[ i ].acc == a )  entries[ i ].acc  = nullptr;
+        }
+    }
+
+    //! @brief Call f( const entry & ) for each label registered, in order, holding the lock.
+    template< typename fn_type >
+    void each( fn_type &&f ) {
+        std::lock_guard< std::mutex > hold( lock );
+        for ( unsigned i = 0; i < used; ++i ) f( entries[ i ] );
+    }
+
+  private:
+
+    registry() = default;
+
+    std::mutex    lock;
+    unsigned      used    { 0 };
+    entry         entries[ max_entries ];
+};
+
+//! @brief Register a histogram under a label.  Remove it before destroying it.
+inline bool add( ::wax::_impl::label::handle label, const ::wax::_impl::stopwatch::histogram &h ) {
+    return registry::get().add( label.id, &h, nullptr );
+}
+
+//! @brief Register an accumulator under a label.  Remove it before destroying it.
+inline bool add( ::wax::_impl::label::handle label,
+                 const ::wax::_impl::stopwatch::accumulator &a ) {
+    return registry::get().add( label.id, nullptr, &a );
+}
+
+inline void remove( const ::wax::_impl::stopwatch::histogram &h ) {
+    registry::get().remove( &h, nullptr );
+}
+
+inline void remove( const ::wax::_impl::stopwatch::accumulator &a ) {
+    registry::get().remove( nullptr, &a );
+}
+
+namespace _impl {
+
+//! @brief Histogram bucket bounds exported, in nanoseconds: 1, 2 and 5 per decade.
+static constexpr int64_t bounds[] = {
+    100, 200, 500,
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+    1000000, 2000000, 5000000, 10000000, 20000000, 50000000, 100000000, 200000000, 500000000,
+    1000000000, 2000000000, 5000000000, 10000000000, 20000000000, 50000000000, 100000000000,
+};
+
+inline void quoted( std::string &out, const char *s ) {
+    out += '"';
+    for ( ; s && *s; ++s ) {
+        if ( *s == '\\' )      out += "\\\\";
+        else if ( *s == '"' )  out += "\\\"";
+        else if ( *s == '\n' ) out += "\\n";
+        else                   out += *s;
+    }
+    out += '"';
+}
+
+inline void number( std::string &out, double v ) {
+    char buf[ 32 ];
+    const int n = ::snprintf( buf, sizeof buf, "%.9g", v );
+    if ( n > 0 ) out.append( buf, n );
+}
+
+inline void sample( std::string &out, const std::string &name, const char *suffix,
+                    const char *label, const char *le, double v ) {
+    out += name;
+    out += suffix;
+    out += "{label=";
+    quoted( out, label );
+    if ( le ) {
+        out += ",le=\"";
+        out += le;
+        out += '"';
+    }
+    out += "} ";
+    number( out, v );
+    out += '\n';
+}
+
+inline const char *name_of( label_id id ) {
+    const char *n = ::wax::_impl::label::name( id );
+    return n ? n : "";
+}
+
+}
+
+//! @brief Append every registered histogram and accumulator to out in OpenMetrics text.
+//
+//  prefix_seconds              histogram, per label with a histogram; _sum from its
+//                              accumulator if it has one too.
+//  prefix_accumulated_seconds  summary (count and sum), per label with only an accumulator.
+//  prefix_min_seconds          gauges, per label with an accumulator.
+//  prefix_max_seconds
+//
+// Ends with "# EOF".  Histogram buckets are cumulative on 1-2-5 bounds from 100 ns to 100 s,
+// each taking the internal buckets whose top is at or below the bound.
+//
+inline void openmetrics( std::string &out, const char *prefix = "wax_stopwatch" ) {
+    const std::string base = prefix;
+
+    struct row {
+        const char                                 *label;
+        const ::wax::_impl::stopwatch::histogram   *h;
+        const ::wax::_impl::stopwatch::accumulator *a;
+        ::wax::_impl::stopwatch::moments            m;
+    };
+    std::string hist, summary, lo, hi;
+    registry::get().each( [&]( const registry::entry &e ) {
+        row r { _impl::name_of( e.id ), e.hist, e.acc, {} };
+        if ( r.a ) {
+            r.m = r.a->snapshot();
+            _impl::sample( lo, base, "_min_seconds", r.label, nullptr, r.m.min / 1e9 );
+            _impl::sample( hi, base, "_max_seconds", r.label, nullptr, r.m.max / 1e9 );
+        }
+        if ( r.h ) {
+            using ::wax::_impl::stopwatch::histogram;
+            uint64_t below = 0;
+            unsigned b     = 0;
+            char     le[ 32 ];
+            for ( const int64_t bound : _impl::bounds ) {
+                for ( ; b < histogram::bucket_count && histogram::highest( b ) <= bound; ++b )
+                    below += r.h->at( b );
+                ::snprintf( le, sizeof le, "%.9g", bound / 1e9 );
+                _impl::sample( hist, base, "_seconds_bucket", r.label, le, below );
+            }
+            for ( ; b < histogram::bucket_count; ++b ) below += r.h->at( b );
+            _impl::sample( hist, base, "_seconds_bucket", r.label, "+Inf", below );
+            _impl::sample( hist, base, "_seconds_count", r.label, nullptr, below );
+            if ( r.a ) _impl::sample( hist, base, "_seconds_sum", r.label, nullptr, r.m.sum / 1e9 );
+        } else if ( r.a ) {
+            _impl::sample( summary, base, "_accumulated_seconds_count", r.label, nullptr,
+                           r.m.count );
+            _impl::sample( summary, base, "_accumulated_seconds_sum", r.label, nullptr,
+                           r.m.sum / 1e9 );
+        }
+    } );
+
+    auto family = [&]( const std::string &name, const char *type, const char *help,
+                       const std::string &body ) {
+        if ( body.empty() ) return;
+        out += "# TYPE " + name + ' ' + type + "\n# UNIT " + name + " seconds\n# HELP " + name
+            + ' ' + help + '\n' + body;
+    };
+    family( base + "_seconds", "histogram", "Stopwatch timings.", hist );
+    family( base + "_accumulated_seconds", "summary", "Stopwatch timings.", summary );
+    family( base + "_min_seconds", "gauge", "Shortest stopwatch timing.", lo );
+    family( base + "_max_seconds", "gauge", "Longest stopwatch timing.", hi );
+    out += "# EOF\n";
+}
+
+//! @brief Minimal HTTP server for scrapes, on its own thread.
+//
+// Answers GET /metrics (or /) with openmetrics() and anything else with 404, one connection at
+// a time, closing each after the response.  Setup happens in the constructor; if it failed
+// is_open() is false and errno says why.
+//
+class listener
+{
+  public:
+
+    //! @param port    TCP port; 0 picks a free one, see port().
+    //  @param address IPv4 address to listen on.  Loopback unless said otherwise.
+    //  @param prefix  Metric name prefix; must outlive the listener.
+    explicit listener( uint16_t port, const char *address = "127.0.0.1",
+                       const char *prefix = "wax_stopwatch" ) noexcept( true )
+        :
+        prefix( prefix )
+    {
+        struct sockaddr_in sa;
+        ::memset( &sa, 0, sizeof sa );
+        sa.sin_family = AF_INET;
+        sa.sin_port   = htons( port );
+        if ( ::inet_pton( AF_INET, address, &sa.sin_addr ) != 1 ) {
+            errno = EINVAL;
+            return;
+        }
+        if ( ::pipe2( wake, O_CLOEXEC ) != 0 ) return;
+        fd = ::socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        const int on = 1;
+        socklen_t len = sizeof sa;
+        if ( fd < 0 || ::setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on ) != 0
+             || ::bind( fd, (struct sockaddr *) &sa, sizeof sa ) != 0 || ::listen( fd, 16 ) != 0
+             || ::getsockname( fd, (struct sockaddr *) &sa, &len ) != 0 ) {
+            close_all();
+            return;
+        }
+        bound = ntohs( sa.sin_port );
+        try {
+            server = std::thread( [this] { run(); } );
+        } catch ( ... ) {
+            close_all();
+            errno = EAGAIN;
+        }
+    }
+
+    listener( const listener & ) = delete;
+    listener &operator=( const listener & ) = delete;
+
+    ~listener() {
+        if ( server.joinable() ) {
+            const char c = 0;
+            (void) ! ::write( wake[ 1 ], &c, 1 );
+            server.join();
+        }
+        close_all();
+    }
+
+    bool is_open() const noexcept( true ) { return fd >= 0; }
+
+    //! @return The port listened on.
+    uint16_t port() const noexcept( true ) { return bound; }
+
+  private:
+
+    void run() {
+        std::string body, reply;
+        for ( ;; ) {
+            struct pollfd p[ 2 ] = { { fd, POLLIN, 0 }, { wake[ 0 ], POLLIN, 0 } };
+            if ( ::poll( p, 2, -1 ) < 0 ) {
+                if ( errno == EINTR ) continue;
+                return;
+            }
+            if ( p[ 1 ].revents ) return;
+            const int c = ::accept4( fd, nullptr, nullptr, SOCK_CLOEXEC );
+            if ( c < 0 ) continue;
+            const struct timeval limit { 1, 0 };
+            (void) ::setsockopt( c, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof limit );
+            (void) ::setsockopt( c, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof limit );
+            answer( c, body, reply );
+            ::close( c );
+        }
+    }
+
+    void answer( int c, std::string &body, std::string &reply ) {
+        char   req[ 4096 ];
+        size_t got = 0;
+        while ( got < sizeof req - 1 ) {
+            const ssize_t n = ::recv( c, req + got, sizeof req - 1 - got, 0 );
+            if ( n <= 0 ) break;
+            got += n;
+            req[ got ] = 0;
+            if ( ::strstr( req, "\r\n\r\n" ) ) break;
+        }
+        req[ got ] = 0;
+        const bool ok = ! ::strncmp( req, "GET /metrics ", 13 ) || ! ::strncmp( req, "GET / ", 6 )
+                     || ! ::strncmp( req, "GET /metrics?", 13 );
+        body.clear();
+        if ( ok ) openmetrics( body, prefix );
+        else      body = "not found\n";
+        reply = ok ? "HTTP/1.0 200 OK\r\nContent-Type: application/openmetrics-text; "
+                     "version=1.0.0; charset=utf-8\r\n"
+                   : "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+        reply += "Content-Length: " + std::to_string( body.size() )
+              + "\r\nConnection: close\r\n\r\n" + body;
+        for ( size_t off = 0; off < reply.size(); ) {
+            const ssize_t n = ::send( c, reply.data() + off, reply.size() - off, MSG_NOSIGNAL );
+            if ( n <= 0 ) break;
+            off += n;
+        }
+    }
+
+    void close_all() noexcept( true ) {
+        const int saved = errno;
+        if ( fd >= 0 ) ::close( fd );
+        for ( int &w : wake )
+            if ( w >= 0 ) ::close( w );
+        fd = wake[ 0 ] = wake[ 1 ] = -1;
+        errno = saved;
+    }
+
+    const char   *prefix;
+    int           fd        { -1 };
+    int           wake[ 2 ] { -1, -1 };
+    uint16_t      bound     {  0 };
+    std::thread   server;
+};
+
+}
+
+namespace stopwatch {
+
+//! @brief A histogram and an accumulator under one label, registered for export.
+//
+// A sink, so stopwatches record straight into it.  Registered for as long as it lives: the
+// destructor removes it, waiting for any export reading it.
+//
+class metric
+{
+  public:
+
+    explicit metric( ::wax::_impl::label::handle label ) : id( label.id ) {
+        ::wax::_impl::metrics::registry::get().add( id, &hist, &acc );
+    }
+
+    ~metric() { ::wax::_impl::metrics::registry::get().remove( &hist, &acc ); }
+
+    metric( const metric & ) = delete;
+    metric &operator=( const metric & ) = delete;
+
+    //! @brief Sink interface.
+    void record( const sample &s ) noexcept( true ) {
+        hist.record( s );
+        acc.record( s );
+    }
+
+    const histogram   &distribution() const noexcept( true ) { return hist; }
+    const accumulator &totals()       const noexcept( true ) { return acc; }
+
+    ::wax::_impl::label::id_type label_id() const noexcept( true ) { return id; }
+
+  private:
+
+    ::wax::_impl::label::id_type  id;
+    histogram                     hist;
+    accumulator                   acc;
+};
+
+}
+}
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include "sw_base.ipp"
+#include "sw_disabled.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief One stopwatch reading several clocks over the same region.
+//
+//  stopwatch::multi< clock::monotonic, clock::cpu::thread > sw( "handler", fd );
+//
+// Starts are read back to back in the order given and stops in the reverse order, so each
+// clock's interval encloses the ones after it.  On scope exit one sample carries every clock
+// in sample::readings, and the line for the first clock is followed by one per other clock plus
+// the off-CPU time and utilization derived from them.  The first clock is the stopwatch's own:
+// lap() and the sample's ns are on it.
+//
+// Every clock is warmed before any is read, so that a first multi doesn't time tsc calibration or
+// the opening of the task-clock page into the clocks started ahead of it.
+//
+template< clock::_hw_type... clocks >
+struct warmed
+{
+    warmed() noexcept( true ) { ( clock::warm< clocks >(), ... ); }
+};
+
+template< clock::_hw_type first, clock::_hw_type... rest >
+class multi : private warmed< first, rest... >, public base< first >
+{
+  public:
+
+    static constexpr size_t clock_count = 1 + sizeof...( rest );
+
+    template< typename... args >
+    explicit multi( args &&... a )
+        :
+        warmed< first, rest... >(),
+        base< first >( std::forward< args >( a )... ),
+        starts { clock::ticks< rest >()... }
+    {}
+
+    multi( const multi & ) = delete;
+    multi &operator=( const multi & ) = delete;
+
+    ~multi() {
+        if ( ! this->reporting() ) return;
+        reading r[ clock_count ];
+        stop( r );
+        sample s = this->summary( r[ 0 ].ns );
+        s.readings      = r;
+        s.reading_count = clock_count;
+        this->finish( s );
+    }
+
+    //! @brief Reset every clock.
+    //  @return 0 on success, -1 on failure.  Errno set to cause of failure.
+    int reset() noexcept( true ) {
+        const int rc = base< first >::reset();
+        read< rest... >( starts );
+        return rc;
+    }
+
+    //! @brief Read every clock now, as the destructor does.
+    //  @param r One reading per clock, in template order.
+    void stop( reading *r ) const noexcept( true ) {
+        clock::tick_type ends[ sizeof...( rest ) + 1 ];
+        read_reverse< rest... >( ends );
+        const clock::tick_type end = clock::ticks< first >();
+        r[ 0 ] = { first, clock::timestamp< first >( this->started() ),
+                   clock::to_ns< first >( end - this->started() ) };
+        convert< rest... >( r + 1, starts, ends );
+    }
+
+    //! @return Wall time, CPU time, off-CPU time and utilization so far.
+    derived metrics() const noexcept( true ) {
+        reading r[ clock_count ];
+        stop( r );
+        return derive( r, clock_count );
+    }
+
+  private:
+
+    template< clock::_hw_type... none >
+    static typename std::enable_if< sizeof...( none ) == 0 >::type
+    read( clock::tick_type * ) noexcept( true ) {}
+
+    template< clock::_hw_type c, clock::_hw_type... cs >
+    static void read( clock::tick_type *t ) noexcept( true ) {
+        t[ 0 ] = clock::ticks< c >();
+        read< cs... >( t + 1 );
+    }
+
+    template< clock::_hw_type... none >
+    static typename std::enable_if< sizeof...( none ) == 0 >::type
+    read_reverse( clock::tick_type * ) noexcept( true ) {}
+
+    template< clock::_hw_type c, clock::_hw_type... cs >
+    static void read_reverse( clock::tick_type *t ) noexcept( true ) {
+        read_reverse< cs... >( t + 1 );
+        t[ 0 ] = clock::ticks< c >();
+    }
+
+    template< clock::_hw_type... none >
+    static typename std::enable_if< sizeof...( none ) == 0 >::type
+    convert( reading *, const clock::tick_type *, const clock::tick_type * ) noexcept( true ) {}
+
+    template< clock::_hw_type c, clock::_hw_type... cs >
+    static void convert( reading *r, const clock::tick_type *from,
+                         const clock::tick_type *to ) noexcept( true ) {
+        r[ 0 ] = { c, clock::timestamp< c >( from[ 0 ] ),
+                   clock::to_ns< c >( to[ 0 ] - from[ 0 ] ) };
+        convert< cs... >( r + 1, from + 1, to + 1 );
+    }
+
+    clock::tick_type starts[ sizeof...( rest ) + 1 ];   //< One spare so that rest can be empty.
+};
+
+//! @brief multi< clocks... >, or disabled< first > under WAX_STOPWATCH_DISABLE.
+#if defined( WAX_STOPWATCH_DISABLE )
+template< clock::_hw_type first, clock::_hw_type... rest >
+using enabled_multi = disabled< first >;
+#else
+template< clock::_hw_type first, clock::_hw_type... rest >
+using enabled_multi = multi< first, rest... >;
+#endif
+
+}
+}
+}
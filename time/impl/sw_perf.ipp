@@ -0,0 +1,282 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include "sw_base.ipp"
+#include "sw_disabled.ipp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace pmu
+//  @brief Hardware and kernel event counters for the calling thread, via perf_event_open(2).
+//
+// Each thread opens one counter group per set of events, the first time it asks, and keeps it
+// until it exits.  Hardware events count user space only, which is what perf_event_paranoid 2
+// allows an unprivileged process; kernel events count in the kernel too where permitted.
+// Where the kernel lets user space read the counters directly a reading is one rdpmc per event,
+// with no syscall; otherwise it is one read(2) of the whole group.
+//
+namespace pmu {
+
+enum event : uint32_t {
+    cycles,
+    instructions,
+    llc_misses,
+    branch_misses,
+    context_switches,
+    page_faults,
+};
+
+//! @return The name perf(1) uses for an event.
+constexpr const char *name( event e ) noexcept( true ) {
+    return e == cycles           ? "cycles"
+         : e == instructions     ? "instructions"
+         : e == llc_misses       ? "LLC-misses"
+         : e == branch_misses    ? "branch-misses"
+         : e == context_switches ? "context-switches"
+         : e == page_faults      ? "page-faults" : "?";
+}
+
+namespace _impl {
+
+inline void attr_of( event e, struct perf_event_attr &a ) noexcept( true ) {
+    ::memset( &a, 0, sizeof a );
+    a.size           = sizeof a;
+    a.exclude_kernel = 1;
+    a.exclude_hv     = 1;
+    switch ( e ) {
+        case cycles:
+            a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_CPU_CYCLES;        break;
+        case instructions:
+            a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_INSTRUCTIONS;      break;
+        case llc_misses:
+            a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_CACHE_MISSES;      break;
+        case branch_misses:
+            a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_BRANCH_MISSES;     break;
+        case context_switches:
+            a.type = PERF_TYPE_SOFTWARE; a.config = PERF_COUNT_SW_CONTEXT_SWITCHES;  break;
+        case page_faults:
+            a.type = PERF_TYPE_SOFTWARE; a.config = PERF_COUNT_SW_PAGE_FAULTS;       break;
+    }
+}
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+inline uint64_t rdpmc( uint32_t counter ) noexcept( true ) {
+    uint32_t lo, hi;
+    asm volatile( "rdpmc" : "=a"( lo ), "=d"( hi ) : "c"( counter ) );
+    return lo | (uint64_t) hi << 32;
+}
+
+//! @brief Read an event from user space through its mmap page.
+//  @return False if the kernel doesn't allow it right now; read the descriptor instead.
+inline bool read_page( const volatile struct perf_event_mmap_page *pc,
+                       uint64_t &value ) noexcept( true ) {
+    uint32_t seq;
+    do {
+        seq = pc->lock;
+        asm volatile( "" : : : "memory" );
+        const uint32_t index = pc->index;
+        if ( ! pc->cap_user_rdpmc || index == 0 ) return false;
+        const unsigned width = pc->pmc_width;
+        // The counter is width bits wide; sign-extend it.
+        const int64_t  pmc   = (int64_t) ( rdpmc( index - 1 ) << ( 64 - width ) )
+                             >> ( 64 - width );
+        value = pc->offset + pmc;
+        asm volatile( "" : : : "memory" );
+    } while ( pc->lock != seq );
+    return true;
+}
+#else
+inline bool read_page( const volatile struct perf_event_mmap_page *,
+                       uint64_t & ) noexcept( true ) {
+    return false;
+}
+#endif
+
+}
+
+//! @brief The calling thread's counters for a set of events.
+template< event... events >
+class group
+{
+  public:
+
+    static constexpr unsigned size = sizeof...( events );
+
+    static_assert( size > 0, "a counter group needs at least one event" );
+
+    //! @return The calling thread's group, opened on first use.
+    static group &local() {
+        static thread_local group g;
+        return g;
+    }
+
+    group( const group & ) = delete;
+    group &operator=( const group & ) = delete;
+
+    ~group() {
+        for ( unsigned i = 0; i < size; ++i ) {
+            if ( pages[ i ] ) ::munmap( pages[ i ], page_size );
+            if ( fds[ i ] >= 0 ) ::close( fds[ i ] );
+        }
+    }
+
+    //! @return False if any event couldn't be opened; every count then reads 0.
+    bool available() const noexcept( true ) { return ok; }
+
+    //! @brief Current counts, one per event in template order.
+    void read( uint64_t *out ) const noexcept( true ) {
+        if ( ! ok ) {
+            for ( unsigned i = 0; i < size; ++i ) out[ i ] = 0;
+            return;
+        }
+        if ( direct ) {
+            unsigned i = 0;
+            for ( ; i < size; ++i )
+                if ( ! _impl::read_page( pages[ i ], out[ i ] ) ) break;
+            if ( i == size ) return;
+        }
+        struct { uint64_t nr; uint64_t values[ size ]; } buf;
+        if ( ::read( fds[ 0 ], &buf, sizeof buf ) != (ssize_t) sizeof buf ) {
+            for ( unsigned i = 0; i < size; ++i ) out[ i ] = 0;
+            return;
+        }
+        for ( unsigned i = 0; i < size; ++i ) out[ i ] = buf.values[ i ];
+    }
+
+  private:
+
+    group() {
+        static constexpr event list[ size ] = { events... };
+        for ( auto &fd : fds ) fd = -1;
+        page_size = ::sysconf( _SC_PAGESIZE );
+        ok     = true;
+        direct = true;
+        for ( unsigned i = 0; i < size; ++i ) {
+            struct perf_event_attr a;
+            _impl::attr_of( list[ i ], a );
+            if ( i == 0 ) a.read_format = PERF_FORMAT_GROUP;
+            // Kernel events such as context switches happen in the kernel; count them there
+            // if allowed.
+            if ( a.type == PERF_TYPE_SOFTWARE ) a.exclude_kernel = 0;
+            fds[ i ] = open( a, i ? fds[ 0 ] : -1 );
+            if ( fds[ i ] < 0 && ! a.exclude_kernel ) {
+                a.exclude_kernel = 1;
+                fds[ i ] = open( a, i ? fds[ 0 ] : -1 );
+            }
+            if ( fds[ i ] < 0 ) {
+                ok = false;
+                return;
+            }
+            void *p = ::mmap( nullptr, page_size, PROT_READ, MAP_SHARED, fds[ i ], 0 );
+            if ( p == MAP_FAILED ) {
+                direct = false;
+                continue;
+            }
+            pages[ i ] = static_cast< struct perf_event_mmap_page * >( p );
+            direct    &= pages[ i ]->cap_user_rdpmc != 0;
+        }
+    }
+
+    static int open( struct perf_event_attr &a, int leader ) noexcept( true ) {
+        return (int) ::syscall( SYS_perf_event_open, &a, 0, -1, leader, PERF_FLAG_FD_CLOEXEC );
+    }
+
+    int                            fds[ size ];
+    struct perf_event_mmap_page   *pages[ size ] {};
+    size_t                         page_size       { 4096 };
+    bool                           ok              { false };
+    bool                           direct          { false };      //< Every event rdpmc-able.
+};
+
+}
+
+namespace stopwatch {
+
+//! @brief A thread CPU time stopwatch that also counts events over its region.
+//
+// Counts are taken right after the clock at start and right before it at stop, and go out
+// beside the time: in sample::counters, or as one indented line per event.
+//
+template< ::wax::_impl::pmu::event... events >
+class perf : public base< clock::cpu::thread >
+{
+  public:
+
+    using group = ::wax::_impl::pmu::group< events... >;
+
+    static constexpr unsigned event_count = group::size;
+
+    template< typename... args >
+    explicit perf( args &&... a )
+        :
+        base< clock::cpu::thread >( std::forward< args >( a )... ),
+        source( group::local() )
+    {
+        source.read( starts );
+    }
+
+    perf( const perf & ) = delete;
+    perf &operator=( const perf & ) = delete;
+
+    ~perf() {
+        if ( ! this->reporting() ) return;
+        uint64_t now[ event_count ];
+        source.read( now );
+        const int64_t ns = this->lap_ns();
+        static constexpr ::wax::_impl::pmu::event list[ event_count ] = { events... };
+        static const ::wax::_impl::label::id_type ids[ event_count ] = {
+            ::wax::_impl::label::intern( ::wax::_impl::pmu::name( events ) )... };
+        counter c[ event_count ];
+        for ( unsigned i = 0; i < event_count; ++i )
+            c[ i ] = { ::wax::_impl::pmu::name( list[ i ] ), now[ i ] - starts[ i ], ids[ i ] };
+        sample s = summary( ns );
+        if ( source.available() ) {
+            s.counters      = c;
+            s.counter_count = event_count;
+        }
+        this->finish( s );
+    }
+
+    //! @brief Reset the clock and the counts.
+    //  @return 0 on success, -1 on failure.  Errno set to cause of failure.
+    int reset() noexcept( true ) {
+        const int rc = base< clock::cpu::thread >::reset();
+        source.read( starts );
+        return rc;
+    }
+
+    //! @brief Counts so far, one per event in template order.
+    void counts( uint64_t *out ) const noexcept( true ) {
+        source.read( out );
+        for ( unsigned i = 0; i < event_count; ++i ) out[ i ] -= starts[ i ];
+    }
+
+    //! @return False if the counters couldn't be opened here, e.g. no PMU in a VM, or
+    //  perf_event_paranoid above 2.  Then counts are all 0 and samples carry none.
+    bool available() const noexcept( true ) { return source.available(); }
+
+  private:
+
+    const group  &source;
+    uint64_t      starts[ event_count ];
+};
+
+//! @brief perf< events... >, or disabled< cpu::thread > under WAX_STOPWATCH_DISABLE.
+#if defined( WAX_STOPWATCH_DISABLE )
+template< ::wax::_impl::pmu::event... events >
+using enabled_perf = disabled< clock::cpu::thread >;
+#else
+template< ::wax::_impl::pmu::event... events >
+using enabled_perf = perf< events... >;
+#endif
+
+}
+}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include "sw_label.ipp"
+#include "sw_sink.ipp"
+#include "sw_thread.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief Count, sum and max per label, for many long-lived labels, in one arena.
+//
+// Slots are indexed by label id, so finding one is a bounds check.  The arena is a single
+// allocation holding three arrays, counts, sums and maxes, each cache-line aligned, so that the
+// counters of thousands of labels sit in a few hundred contiguous lines rather than one heap
+// block apiece, and a sweep over any one field is a straight loop over packed integers.
+//
+// Recording is two fetch_adds and, when the max moves, a compare-exchange.  Labels whose ids are
+// beyond capacity, or any record when the arena couldn't be allocated, only count as dropped.
+// A snapshot taken while others record sees each value whole, but may see a record's count
+// without yet seeing its sum.
+//
+class registry
+{
+  public:
+
+    //! @param capacity Highest label id to keep, plus one.  Ids are dense from 1 in order of
+    //  first interning, so this is about how many labels the process will have.
+    explicit registry( label_id capacity = 4096 ) noexcept( true ) {
+        const size_t bytes = 3 * stride( capacity );
+        void *p = ::operator new( bytes, std::align_val_t( cache_line ), std::nothrow );
+        if ( ! p ) return;
+        arena  = static_cast< char * >( p );
+        slots  = capacity;
+        ::memset( arena, 0, bytes );
+    }
+
+    registry( const registry & ) = delete;
+    registry &operator=( const registry & ) = delete;
+
+    ~registry() {
+        if ( arena ) ::operator delete( arena, std::align_val_t( cache_line ) );
+    }
+
+    //! @return Number of slots, one per label id from 0; slot 0 is label::none and stays empty.
+    label_id size() const noexcept( true ) { return slots; }
+
+    //! @brief Add n occurrences of a value in nanoseconds under a label.
+    void record( label_id id, int64_t ns, uint64_t n = 1 ) noexcept( true ) {
+        if ( __builtin_expect( id == ::wax::_impl::label::none || id >= slots, 0 ) ) {
+            __atomic_fetch_add( &lost, n, __ATOMIC_RELAXED );
+            return;
+        }
+        __atomic_fetch_add( &counts()[ id ], n,                __ATOMIC_RELAXED );
+        __atomic_fetch_add( &sums()[ id ],   ns * (int64_t) n, __ATOMIC_RELAXED );
+        int64_t *m   = &maxes()[ id ];
+        int64_t  old = __atomic_load_n( m, __ATOMIC_RELAXED );
+        while ( ns > old && ! __atomic_compare_exchange_n( m, &old, ns, true, __ATOMIC_RELAXED,
+                                                           __ATOMIC_RELAXED ) ) {}
+    }
+
+    void record( ::wax::_impl::label::handle label, int64_t ns,
+                 uint64_t n = 1 ) noexcept( true ) {
+        record( label.id, ns, n );
+    }
+
+    //! @brief Sink interface.  A stopwatch with only a name has it interned here.
+    void record( const sample &s ) {
+        record( s.id ? s.id : ::wax::_impl::label::intern( s.label ), s.ns, s.weight );
+    }
+
+    uint64_t count( label_id id ) const noexcept( true ) { return load( counts(), id ); }
+    int64_t  sum( label_id id )   const noexcept( true ) { return load( sums(), id ); }
+    int64_t  max( label_id id )   const noexcept( true ) { return load( maxes(), id ); }
+
+    //! @return Records that had no slot.
+    uint64_t dropped() const noexcept( true ) {
+        return __atomic_load_n( &lost, __ATOMIC_RELAXED );
+    }
+
+    //! @brief Copy out size() of each field.  Any output may be nullptr to skip that field.
+    void snapshot( uint64_t *count_out, int64_t *sum_out,
+                   int64_t *max_out ) const noexcept( true ) {
+        if ( count_out ) copy( count_out, counts() );
+        if ( sum_out )   copy( sum_out, sums() );
+        if ( max_out )   copy( max_out, maxes() );
+    }
+
+    //! @brief Zero every slot.  Records made during the sweep may be lost, or half kept.
+    void reset() noexcept( true ) {
+        if ( arena ) ::memset( arena, 0, 3 * stride( slots ) );
+        __atomic_store_n( &lost, 0, __ATOMIC_RELAXED );
+    }
+
+  private:
+
+    //! @return Bytes per field, rounded up to whole cache lines.
+    static size_t stride( label_id n ) noexcept( true ) {
+        return ( n * sizeof( int64_t ) + cache_line - 1 ) / cache_line * cache_line;
+    }
+
+    uint64_t *counts() const noexcept( true ) {
+        return static_cast< uint64_t * >( __builtin_assume_aligned( arena, cache_line ) );
+    }
+    int64_t  *sums() const noexcept( true ) {
+        return static_cast< int64_t * >(
+            __builtin_assume_aligned( arena + stride( slots ), cache_line ) );
+    }
+    int64_t  *maxes() const noexcept( true ) {
+        return static_cast< int64_t * >(
+            __builtin_assume_aligned( arena + 2 * stride( slots ), cache_line ) );
+    }
+
+    template< typename value_type >
+    value_type load( const value_type *field, label_id id ) const noexcept( true ) {
+        return id < slots ? __atomic_load_n( &field[ id ], __ATOMIC_RELAXED ) : 0;
+    }
+
+    // Plain loads, so that the compiler can vectorize; every slot is aligned, so none tears.
+    template< typename value_type >
+    void copy( value_type *__restrict out, const value_type *__restrict field ) const
+        noexcept( true ) {
+        const label_id n = slots;
+        for ( label_id i = 0; i < n; ++i ) out[ i ] = field[ i ];
+    }
+
+    char      *arena    { nullptr };
+    label_id   slots    { 0 };
+    uint64_t   lost     { 0 };
+};
+
+}
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include "sw_config.hpp"
+#include "sw_label.ipp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace report
+//  @brief Text output for stopwatches given a file descriptor, off the timed thread.
+//
+// A stopwatch going out of scope pushes a fixed-size record onto a ring owned by its thread: a
+// few stores, no locks, no syscalls.  A background thread drains every ring, formats the
+// records and hands each descriptor all of its lines in one writev(), waking early when a ring
+// passes a quarter full.  If a ring is full the record is dropped and counted rather than
+// making the timed thread wait; the count is in dropped(), and on standard error at exit.
+// Labels travel as interned ids, so the text they came from needn't outlive the push().
+//
+namespace report {
+
+//! @brief One line of output, before formatting.
+struct record {
+    ::wax::_impl::label::id_type    label;  //< Name of the stopwatch, or label::none.
+    int64_t                         ns;     //< Elapsed time.
+    int16_t                         clock;  //< Clock the time was read from.
+    uint8_t                         depth;  //< 1 for a detail under the line before, else 0.
+    uint8_t                         kind;   //< duration; ratio, ns in parts per million; count.
+    int                             fd;     //< Where the line goes.  Must stay open until
+                                            //  flush(), or until the program exits.
+};
+
+static constexpr uint8_t duration = 0;
+static constexpr uint8_t ratio    = 1;
+static constexpr uint8_t count    = 2;
+
+namespace _impl {
+
+//! @brief Write all of a buffer, riding out short writes and signals.
+WAX_STOPWATCH_API void write_all( int fd, struct iovec *iov, int n );
+
+}
+
+//! @brief Queue a line for r.fd from the calling thread.  r.fd must stay open until it has been
+//  written: through flush(), or at exit.
+WAX_STOPWATCH_API void push( const record &r );
+
+//! @brief Write everything queued so far, from every thread, before returning.  A descriptor
+//  may be closed once this returns, provided nothing has pushed to it since.
+WAX_STOPWATCH_API void flush();
+
+//! @return Lines lost so far because a thread queued them faster than they were written.
+WAX_STOPWATCH_API uint64_t dropped();
+
+}
+}
+}
+
+#if ! defined( WAX_STOPWATCH_LIBRARY )
+#include "lib/sw_report.ipp"
+#endif
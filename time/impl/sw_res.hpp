@@ -12,8 +12,14 @@ static constexpr unsigned usec = 1000U;          //< microseconds
 static constexpr unsigned nsec = 1U;             //< nanoseconds
 
 namespace _impl {
-using suffix_entry = std::pair< decltype( sec ), const char * >;
-const static std::vector<suffix_entry> suffix_table {
+struct suffix_entry {
+    decltype( sec )  first;
+    const char      *second;
+};
+
+// One copy for the whole program, built at compile time.  A plain array, so that this header
+// needs no others.
+inline constexpr suffix_entry suffix_table[] {
     { sec,  "s"   },
     { msec, "ms"  },
     { usec, "μs" },
@@ -27,13 +33,21 @@ const static std::vector<suffix_entry> suffix_table {
 //
 //  @param res
 //
-static inline const char * const units( decltype( sec ) res ) {
+constexpr const char *units( decltype( sec ) res ) noexcept( true ) {
     // Yes, linear search is hell-and-gone faster for small N.
-    for ( const auto s : _impl::suffix_table )
+    for ( const auto &s : _impl::suffix_table )
         if ( s.first == res ) return s.second;
     return "";
 }
 
+//! @return The suffix for a resolution known at compile time, e.g. units< res::usec >().  No
+//  search happens at run time.
+template< decltype( sec ) res >
+constexpr const char *units() noexcept( true ) {
+    constexpr const char *u = units( res );
+    return u;
+}
+
 }
 }
 }
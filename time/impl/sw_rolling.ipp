@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include "sw_accumulator.ipp"
+#include "sw_base.ipp"
+#include "sw_histogram.ipp"
+#include "sw_sink.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief A ring of aggregates, one per epoch of fixed length, for statistics over recent time.
+//
+// A record goes to the aggregate for the epoch it falls in, by one read of the coarse monotonic
+// clock; nothing is kept per sample.  The ring has one more slot than the epochs it keeps, so
+// that the slot after the current one can be cleared while nobody writes to it: the first record
+// in each new epoch wins a compare-exchange on the current epoch and clears the next slot ahead
+// of time, with no lock.  Every slot is stamped with its epoch and queries use only slots whose
+// stamps fall in the window, so stale ones never count.
+//
+// If no one records for a whole epoch, the first record after the gap also clears the slot it
+// is about to write to, and records racing that clear may be lost.
+//
+template< typename aggregate, unsigned epochs >
+class rolling
+{
+  public:
+
+    static_assert( epochs > 0, "a rolling window needs at least one epoch" );
+
+    //! @param epoch_ns Length of each epoch.  Windows are whole epochs, so this is their grain;
+    //  the longest window is epochs of them.
+    explicit rolling( int64_t epoch_ns = 1000000000 )
+        :
+        length( epoch_ns > 0 ? epoch_ns : 1 ),
+        slots( new slot[ ring ] )
+    {
+        const uint64_t e = now();
+        current.store( e, std::memory_order_relaxed );
+        for ( unsigned i = 0; i < ring; ++i )
+            slots[ i ].stamp.store( never, std::memory_order_relaxed );
+        slots[ e % ring ].stamp.store( e, std::memory_order_relaxed );
+        slots[ ( e + 1 ) % ring ].stamp.store( e + 1, std::memory_order_release );
+    }
+
+    rolling( const rolling & ) = delete;
+    rolling &operator=( const rolling & ) = delete;
+
+    //! @brief Count n occurrences of a value in nanoseconds in the current epoch.
+    void record( int64_t ns, uint64_t n = 1 ) noexcept( true ) {
+        const uint64_t e = now();
+        if ( __builtin_expect( e > current.load( std::memory_order_acquire ), 0 ) ) advance( e );
+        slots[ e % ring ].data.record( ns, n );
+    }
+
+    //! @brief Sink interface, for stopwatches constructed against this.
+    void record( const sample &s ) noexcept( true ) { record( s.ns, s.weight ); }
+
+    //! @brief Call f( const aggregate & ) for each epoch in the last window_ns, newest first,
+    //  including the one in progress.
+    template< typename fn_type >
+    void each( int64_t window_ns, fn_type &&f ) const {
+        const uint64_t e = now();
+        uint64_t k = window_ns > 0 ? ( window_ns + length - 1 ) / length : 1;
+        if ( k > epochs ) k = epochs;
+        for ( uint64_t i = 0; i < k && i <= e; ++i ) {
+            const slot &s = slots[ ( e - i ) % ring ];
+            if ( s.stamp.load( std::memory_order_acquire ) == e - i ) f( s.data );
+        }
+    }
+
+    //! @return The value at or below which pct percent of values in the last window_ns fall;
+    //  see histogram::percentile().  For a ring of histograms.
+    int64_t percentile( double pct, int64_t window_ns ) const {
+        std::unique_ptr< histogram > sum( new histogram );
+        return percentile( pct, window_ns, *sum );
+    }
+
+    //! @brief percentile(), merging into scratch rather than allocating.  Scratch is cleared
+    //  first and left holding the window's counts.
+    int64_t percentile( double pct, int64_t window_ns, histogram &scratch ) const noexcept( true ) {
+        scratch.clear();
+        each( window_ns, [ &scratch ]( const histogram &h ) { scratch.merge( h ); } );
+        return scratch.percentile( pct );
+    }
+
+    //! @return Values in the last window_ns.  For a ring of histograms.
+    uint64_t count( int64_t window_ns ) const {
+        uint64_t n = 0;
+        each( window_ns, [ &n ]( const histogram &h ) { n += h.count(); } );
+        return n;
+    }
+
+    //! @return Totals over the last window_ns.  For a ring of accumulators.
+    moments snapshot( int64_t window_ns ) const {
+        moments m;
+        each( window_ns, [ &m ]( const accumulator &a ) { m.merge( a.snapshot() ); } );
+        return m;
+    }
+
+    //! @return Length of an epoch in nanoseconds.
+    int64_t epoch_ns() const noexcept( true ) { return length; }
+
+    //! @return Longest window that can be asked for, in nanoseconds.
+    int64_t span_ns() const noexcept( true ) { return length * epochs; }
+
+  private:
+
+    static constexpr unsigned ring  = epochs + 1;
+    static constexpr uint64_t never = std::numeric_limits< uint64_t >::max();
+
+    struct slot {
+        aggregate                data;
+        std::atomic< uint64_t >  stamp   { never };     //< Epoch data belongs to.
+    };
+
+    uint64_t now() const noexcept( true ) {
+        return clock::to_ns< clock::coarse >( clock::ticks< clock::coarse >() ) / length;
+    }
+
+    // Entered by every record that sees a new epoch; only the one that moves current does work.
+    void advance( uint64_t e ) noexcept( true ) {
+        uint64_t seen = current.load( std::memory_order_acquire );
+        while ( seen < e )
+            if ( current.compare_exchange_weak( seen, e, std::memory_order_acq_rel ) ) break;
+        if ( seen >= e ) return;
+        // Epochs seen + 1 .. e + 1 but the first were never cleared ahead; at most a ring of them.
+        uint64_t x = seen + 2;
+        if ( e + 2 > ring && x < e + 2 - ring ) x = e + 2 - ring;
+        for ( ; x <= e + 1; ++x ) {
+            slot &s = slots[ x % ring ];
+            s.stamp.store( never, std::memory_order_relaxed );
+            s.data.clear();
+            s.stamp.store( x, std::memory_order_release );
+        }
+    }
+
+    const int64_t                  length;
+    std::unique_ptr< slot[] >      slots;
+    std::atomic< uint64_t >        current   { 0 };
+};
+
+}
+}
+}
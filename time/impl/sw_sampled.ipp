@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include <optional>
+#include <utility>
+#include "sw_base.ipp"
+#include "sw_disabled.ipp"
+#include "sw_thread.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief Per-thread choice of which runs to time, about one in n.
+//
+// A countdown, reloaded from an xorshift with a gap anywhere in [1, 2n - 1], so that the
+// average is n but a workload that repeats with some period can't line up with it.  Calls that
+// aren't due cost a thread-local decrement and a compare.
+//
+template< unsigned n >
+class pacer
+{
+  public:
+
+    static_assert( n > 0, "sample one in at least one" );
+
+    //! @return True if this run is to be timed.
+    static bool due() noexcept( true ) {
+        state &s = local();
+        if ( __builtin_expect( s.left > 1, 1 ) ) {
+            --s.left;
+            return false;
+        }
+        s.left = gap( s );
+        return true;
+    }
+
+  private:
+
+    struct state {
+        uint32_t  left  { 0 };
+        uint64_t  x     { 0 };
+    };
+
+    static state &local() noexcept( true ) {
+        static thread_local state s;
+        return s;
+    }
+
+    static uint32_t gap( state &s ) noexcept( true ) {
+        if ( n == 1 ) return 1;
+        if ( __builtin_expect( s.x == 0, 0 ) )
+            s.x = ( ::wax::_impl::thread::id() + 1 ) * 0x9e3779b97f4a7c15UL | 1;
+        s.x ^= s.x << 13;
+        s.x ^= s.x >> 7;
+        s.x ^= s.x << 17;
+        return 1 + (uint32_t) ( s.x % ( 2 * (uint64_t) n - 1 ) );
+    }
+};
+
+//! @brief A base<> whose sample stands for weight runs.
+template< unsigned weight, clock::_hw_type clock_type >
+class weighted : public base< clock_type >
+{
+  public:
+
+    template< typename... args >
+    explicit weighted( args &&... a ) : base< clock_type >( std::forward< args >( a )... ) {}
+
+    ~weighted() {
+        if ( ! this->reporting() ) return;
+        sample s = this->summary( this->lap_ns() );
+        s.weight = weight;
+        this->finish( s );
+    }
+};
+
+//! @brief A stopwatch that times about one run in n and does nothing on the rest.
+//
+//  static stopwatch::histogram h;
+//  void hot() { stopwatch::sampled< 64 > sw( h ); ... }
+//
+// On a run that isn't due nothing is constructed and no clock is read.  A timed run's sample has
+// weight n, so histograms and accumulators count it n times and their totals stay in step with
+// the calls made.  With a descriptor only the timed runs print.
+//
+template< unsigned n, clock::_hw_type clock_type >
+class sampled
+{
+  public:
+
+    template< typename... args >
+    explicit sampled( args &&... a ) {
+        if ( __builtin_expect( pacer< n >::due(), 0 ) )
+            sw.emplace( std::forward< args >( a )... );
+    }
+
+    sampled( const sampled & ) = delete;
+    sampled &operator=( const sampled & ) = delete;
+
+    //! @return True if this run is being timed.
+    bool timed() const noexcept( true ) { return sw.has_value(); }
+
+    //! @return Current lap time in whole nanoseconds, or 0 if this run isn't timed.
+    int64_t lap_ns() const noexcept( true ) { return sw ? sw->lap_ns() : 0; }
+
+    //! @return The label associated with this stopwatch, or nullptr.
+    const char *name() const noexcept( true ) { return sw ? sw->name() : nullptr; }
+
+    //! @return The resolution of the stopwatch in nanoseconds.
+    unsigned long res() const noexcept( true ) { return clock::resolution< clock_type >(); }
+
+  private:
+
+    std::optional< weighted< n, clock_type > > sw;
+};
+
+//! @brief sampled< n, clock_type >, or disabled< clock_type > under WAX_STOPWATCH_DISABLE.
+#if defined( WAX_STOPWATCH_DISABLE )
+template< unsigned n, clock::_hw_type clock_type >
+using enabled_sampled = disabled< clock_type >;
+#else
+template< unsigned n, clock::_hw_type clock_type >
+using enabled_sampled = sampled< n, clock_type >;
+#endif
+
+}
+}
+}
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <thread>
+#include "sw_accumulator.ipp"
+#include "sw_base.ipp"
+#include "sw_label.ipp"
+#include "sw_sink.ipp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace shm
+//  @brief Aggregates in a named POSIX shared memory segment, for a reader in another process.
+//
+//  [ header | slots ... ]
+//
+// One slot per label and clock: the label's name, the clock, and the count, sum, sum of squares,
+// min, max and a histogram with eight buckets per power of two of the times on that clock, so
+// wall and CPU time under one label stay apart.  Writers take a slot's sequence number odd,
+// update it and make it even again, so a reader that sees the same even number before and after
+// copying a slot has a consistent snapshot; writers in the same process take turns on a slot.
+// Slots are claimed in order, and named and given their clock before header::used covers them.
+// The header also carries the process's CLOCK_REALTIME and CLOCK_PROCESS_CPUTIME_ID, refreshed
+// together under their own sequence number.  Everything is fixed size and offsets are in the
+// header, so a reader checks the magic, version and sizes and needs nothing else.
+//
+namespace shm {
+
+static constexpr char      magic[ 8 ]    = { 'W', 'A', 'X', 'S', 'H', 'M', 'E', 'M' };
+static constexpr uint32_t  version       = 2;
+static constexpr uint32_t  header_size   = 4096;
+static constexpr uint32_t  name_size     = 64;
+
+//! @brief Histogram buckets: values below 16 ns one each, then 8 per power of two to 2^44 ns.
+static constexpr unsigned  sub_bits      = 3;
+static constexpr unsigned  max_bits      = 44;
+static constexpr unsigned  bucket_count  = ( max_bits - sub_bits + 1 ) << sub_bits;
+
+//! @return Bucket holding the value ns.
+constexpr unsigned index( int64_t ns ) noexcept( true ) {
+    const uint64_t top   = ( 1UL << max_bits ) - 1;
+    const uint64_t v     = ns < 0 ? 0 : (uint64_t) ns > top ? top : ns;
+    const unsigned msb   = 63 - __builtin_clzl( v | 1 );
+    const unsigned shift = msb > sub_bits ? msb - sub_bits : 0;
+    return ( shift << sub_bits ) + ( v >> shift );
+}
+
+//! @return Largest value counted in a bucket.
+constexpr int64_t highest( unsigned i ) noexcept( true ) {
+    const unsigned shift = ( i >> sub_bits ? i >> sub_bits : 1 ) - 1;
+    return ( (int64_t) ( i - ( shift << sub_bits ) ) << shift ) + ( 1L << shift ) - 1;
+}
+
+struct header {
+    char                     magic[ 8 ];
+    uint32_t                 version;
+    uint32_t                 slot_size;
+    uint32_t                 bucket_count;
+    uint32_t                 capacity;          //< Slots in the segment.
+    uint64_t                 slots_offset;
+    uint32_t                 pid;
+    std::atomic< uint32_t >  live;              //< 1 until the writer closes it.
+    std::atomic< uint32_t >  used;              //< Slots claimed and named.
+    std::atomic< uint32_t >  seq;               //< Guards the clocks; odd while updating.
+    std::atomic< int64_t  >  real_ns;           //< CLOCK_REALTIME at the last refresh.
+    std::atomic< int64_t  >  cpu_ns;            //< CLOCK_PROCESS_CPUTIME_ID at the same time.
+    int64_t                  started_real_ns;   //< CLOCK_REALTIME when created.
+};
+
+struct alignas( ::wax::_impl::cache_line ) slot {
+    std::atomic< uint32_t >  seq;
+    int32_t                  clock;             //< Clock the times are on; fixed with the name.
+    char                     name[ name_size ];
+    std::atomic< uint64_t >  count;
+    std::atomic< int64_t  >  sum;
+    std::atomic< double   >  sumsq;
+    std::atomic< int64_t  >  min;
+    std::atomic< int64_t  >  max;
+    std::atomic< uint64_t >  buckets[ bucket_count ];
+};
+
+static_assert( sizeof( header ) <= header_size, "shm header must fit its page" );
+static_assert( std::atomic< uint64_t >::is_always_lock_free
+               && std::atomic< double >::is_always_lock_free,
+               "shm fields must be usable across processes" );
+
+//! @brief One slot, as a reader copied it.
+struct totals {
+    char                                    name[ name_size ];
+    clockid_t                               clock;
+    ::wax::_impl::stopwatch::moments        stats;
+    uint64_t                                buckets[ bucket_count ];
+
+    //! @return The value at or below which pct percent fall, to within a bucket (12.5%).
+    int64_t percentile( double pct ) const noexcept( true ) {
+        if ( stats.count == 0 ) return 0;
+        uint64_t rank = (uint64_t) ( pct / 100.0 * stats.count + 0.5 );
+        if ( rank < 1 ) rank = 1;
+        uint64_t seen = 0;
+        for ( unsigned i = 0; i < bucket_count; ++i )
+            if ( ( seen += buckets[ i ] ) >= rank ) return highest( i );
+        return highest( bucket_count - 1 );
+    }
+};
+
+//! @brief The process's clocks, as a reader copied them.
+struct clocks {
+    int64_t  real_ns    { 0 };
+    int64_t  cpu_ns     { 0 };
+};
+
+//! @brief Writer side: creates the segment and is a stopwatch sink.
+//
+// Set up by the constructor; if that failed is_open() is false, errno says why, and samples are
+// discarded.  A thread refreshes the clocks every interval.  Labels and clocks past capacity, or
+// labels with no name, are dropped.  The segment is unlinked on destruction; readers that have
+// it mapped can still read it, and see live go to 0.  A writer that dies without closing leaves
+// live at 1; header::pid says whose it was.
+//
+class segment
+{
+  public:
+
+    //! @param name     Segment name for shm_open(3), e.g. "/wax.worker.3".  Replaced if present.
+    //  @param capacity Most slots it will hold: one per label and clock recorded.
+    explicit segment( const char *name, uint32_t capacity = 1024,
+                      std::chrono::milliseconds interval = std::chrono::milliseconds( 100 ) ) {
+        map_size = header_size + (size_t) capacity * sizeof( slot );
+        ::strncpy( path, name, sizeof path - 1 );
+
+        (void) ::shm_unlink( path );
+        const int fd = ::shm_open( path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644 );
+        if ( fd < 0 ) return;
+        if ( ::ftruncate( fd, map_size ) == 0 ) {
+            void *p = ::mmap( nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+            if ( p != MAP_FAILED ) base = static_cast< char * >( p );
+        }
+        const int saved = errno;
+        ::close( fd );
+        if ( ! base ) ::shm_unlink( path );
+        errno = saved;
+        if ( ! base ) return;
+
+        // The file is zero-filled, which is what every counter starts as.
+        hdr = new ( base ) header;
+        ::memcpy( hdr->magic, magic, sizeof magic );
+        hdr->version         = version;
+        hdr->slot_size       = sizeof( slot );
+        hdr->bucket_count    = bucket_count;
+        hdr->capacity        = capacity;
+        hdr->slots_offset    = header_size;
+        hdr->pid             = (uint32_t) ::getpid();
+        hdr->started_real_ns = clock::now< clock::real >();
+        slots = reinterpret_cast< slot * >( base + header_size );
+        for ( uint32_t i = 0; i < capacity; ++i ) {
+            slot *s = new ( &slots[ i ] ) slot;
+            s->min.store( std::numeric_limits< int64_t >::max(), std::memory_order_relaxed );
+            s->max.store( std::numeric_limits< int64_t >::min(), std::memory_order_relaxed );
+        }
+        refresh();
+        hdr->live.store( 1, std::memory_order_release );
+        ticker = std::thread( [ this, interval ] { run( interval ); } );
+    }
+
+    segment( const segment & ) = delete;
+    segment &operator=( const segment & ) = delete;
+
+    ~segment() {
+        if ( ! base ) return;
+        {
+            std::lock_guard< std::mutex > hold( lock );
+            stopping = true;
+        }
+        wake.notify_all();
+        ticker.join();
+        refresh();
+        hdr->live.store( 0, std::memory_order_release );
+        ::shm_unlink( path );
+        ::munmap( base, map_size );
+        for ( unsigned i = 0; i < chunk_count; ++i ) delete[] chunks[ i ].load();
+    }
+
+    bool is_open() const noexcept( true ) { return base != nullptr; }
+
+    //! @brief Add n occurrences of a value in nanoseconds on a clock under a label.
+    void record( ::wax::_impl::label::id_type id, int64_t ns, uint64_t n = 1,
+                 clockid_t clock = CLOCK_MONOTONIC ) {
+        slot *s = find( id, clock );
+        if ( ! s ) return;
+        uint32_t seq = s->seq.load( std::memory_order_relaxed );
+        while ( ( seq & 1 ) || ! s->seq.compare_exchange_weak( seq, seq + 1,
+                                                              std::memory_order_acquire ) )
+            seq = s->seq.load( std::memory_order_relaxed );
+        // The odd count has to be visible before any of the data: acquire alone doesn't stop
+        // the stores below moving ahead of it.
+        std::atomic_thread_fence( std::memory_order_release );
+        static constexpr auto r = std::memory_order_relaxed;
+        s->count.store( s->count.load( r ) + n, r );
+        s->sum.store( s->sum.load( r ) + ns * (int64_t) n, r );
+        s->sumsq.store( s->sumsq.load( r ) + (double) ns * ns * n, r );
+        if ( ns < s->min.load( r ) ) s->min.store( ns, r );
+        if ( ns > s->max.load( r ) ) s->max.store( ns, r );
+        auto &b = s->buckets[ index( ns ) ];
+        b.store( b.load( r ) + n, r );
+        s->seq.store( seq + 2, std::memory_order_release );
+    }
+
+    //! @brief Sink interface.
+    void record( const ::wax::_impl::stopwatch::sample &s ) {
+        record( s.id ? s.id : ::wax::_impl::label::intern( s.label ), s.ns, s.weight, s.clock );
+    }
+
+  private:
+
+    // Slots are looked up by label and clock together: the label's id, then 4 bits for clock
+    // ids 0 to 14, 15 for any other (the TSC).
+    static constexpr unsigned clock_bits  = 4;
+    static constexpr unsigned chunk_bits  = 8;
+    static constexpr unsigned chunk_size  = 1U << chunk_bits;
+    static constexpr unsigned chunk_count = ( ::wax::_impl::label::max_ids << clock_bits )
+                                            >> chunk_bits;
+    static constexpr uint32_t none        = ~0U;
+
+    static constexpr uint32_t key( ::wax::_impl::label::id_type id, clockid_t clock ) {
+        constexpr clockid_t other = ( 1 << clock_bits ) - 1;
+        return id << clock_bits | (uint32_t) ( clock >= 0 && clock < other ? clock : other );
+    }
+
+    //! @return This label and clock's slot, claimed on first use; nullptr if it can't have one.
+    slot *find( ::wax::_impl::label::id_type id, clockid_t clock ) {
+        if ( ! base || id == ::wax::_impl::label::none
+             || id >= ::wax::_impl::label::max_ids ) return nullptr;
+        const uint32_t                 k     = key( id, clock );
+        const std::atomic< uint32_t > *chunk = chunks[ k >> chunk_bits ]
+                                               .load( std::memory_order_acquire );
+        if ( __builtin_expect( chunk != nullptr, 1 ) ) {
+            const uint32_t i = chunk[ k & ( chunk_size - 1 ) ].load( std::memory_order_acquire );
+            if ( __builtin_expect( i != none, 1 ) ) return &slots[ i ];
+        }
+        return claim( id, clock );
+    }
+
+    slot *claim( ::wax::_impl::label::id_type id, clockid_t clock ) {
+        std::lock_guard< std::mutex > hold( lock );
+        const uint32_t k = key( id, clock );
+        auto &c = chunks[ k >> chunk_bits ];
+        std::atomic< uint32_t > *chunk = c.load( std::memory_order_relaxed );
+        if ( ! chunk ) {
+            chunk = new std::atomic< uint32_t >[ chunk_size ];
+            for ( unsigned i = 0; i < chunk_size; ++i ) chunk[ i ].store( none );
+            c.store( chunk, std::memory_order_release );
+        }
+        auto &entry = chunk[ k & ( chunk_size - 1 ) ];
+        if ( entry.load( std::memory_order_relaxed ) != none )
+            return &slots[ entry.load( std::memory_order_relaxed ) ];
+        const uint32_t i    = hdr->used.load( std::memory_order_relaxed );
+        const char    *name = ::wax::_impl::label::name( id );
+        if ( i >= hdr->capacity || ! name ) return nullptr;
+        ::strncpy( slots[ i ].name, name, name_size - 1 );
+        slots[ i ].clock = clock;
+        hdr->used.store( i + 1, std::memory_order_release );
+        entry.store( i, std::memory_order_release );
+        return &slots[ i ];
+    }
+
+    //! @brief Read both clocks back to back and publish them together.
+    void refresh() noexcept( true ) {
+        const int64_t  cpu  = clock::now< clock::cpu::proc >();
+        const int64_t  real = clock::now< clock::real >();
+        const uint32_t seq  = hdr->seq.load( std::memory_order_relaxed );
+        hdr->seq.store( seq + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        hdr->real_ns.store( real, std::memory_order_relaxed );
+        hdr->cpu_ns.store( cpu, std::memory_order_relaxed );
+        hdr->seq.store( seq + 2, std::memory_order_release );
+    }
+
+    void run( std::chrono::milliseconds interval ) {
+        std::unique_lock< std::mutex > hold( lock );
+        while ( ! stopping ) {
+            wake.wait_for( hold, interval );
+            refresh();
+        }
+    }
+
+    char                                   *base       { nullptr };
+    size_t                                  map_size   {       0 };
+    header                                 *hdr        { nullptr };
+    slot                                   *slots      { nullptr };
+    char                                    path[ 256 ] {};
+    std::atomic< std::atomic< uint32_t > * > chunks[ chunk_count ] {};
+
+    std::mutex                              lock;
+    std::condition_variable                 wake;
+    std::thread                             ticker;
+    bool                                    stopping   { false };
+};
+
+//! @brief Reader side: maps another process's segment read-only.
+class view
+{
+  public:
+
+    explicit view( const char *name ) noexcept( true ) {
+        const int fd = ::shm_open( name, O_RDONLY | O_CLOEXEC, 0 );
+        if ( fd < 0 ) return;
+        struct stat st;
+        if ( ::fstat( fd, &st ) == 0 && (uint64_t) st.st_size >= header_size ) {
+            void *p = ::mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+            if ( p != MAP_FAILED ) {
+                base     = static_cast< const char * >( p );
+                map_size = st.st_size;
+            }
+        }
+        const int saved = errno;
+        ::close( fd );
+        errno = saved;
+        if ( ! base ) return;
+
+        hdr = reinterpret_cast< const header * >( base );
+        if ( ::memcmp( hdr->magic, magic, sizeof magic ) != 0 || hdr->version != version
+             || hdr->slot_size != sizeof( slot ) || hdr->bucket_count != bucket_count
+             || hdr->slots_offset + (uint64_t) hdr->capacity * sizeof( slot ) > map_size ) {
+            ::munmap( const_cast< char * >( base ), map_size );
+            base  = nullptr;
+            hdr   = nullptr;
+            errno = EINVAL;
+            return;
+        }
+        slots = reinterpret_cast< const slot * >( base + hdr->slots_offset );
+    }
+
+    view( const view & ) = delete;
+    view &operator=( const view & ) = delete;
+
+    ~view() {
+        if ( base ) ::munmap( const_cast< char * >( base ), map_size );
+    }
+
+    bool is_open() const noexcept( true ) { return base != nullptr; }
+
+    const header &info() const noexcept( true ) { return *hdr; }
+
+    //! @return False once the writer has closed the segment.
+    bool live() const noexcept( true ) { return hdr->live.load( std::memory_order_acquire ); }
+
+    //! @return Slots in use; read( i ) is valid below this.
+    uint32_t size() const noexcept( true ) { return hdr->used.load( std::memory_order_acquire ); }
+
+    //! @brief Copy slot i, consistently.
+    //  @return False if there is no such slot, or its writer died mid-update.
+    bool read( uint32_t i, totals &out ) const noexcept( true ) {
+        if ( i >= size() ) return false;
+        static constexpr auto r = std::memory_order_relaxed;
+        const slot &s = slots[ i ];
+        ::memcpy( out.name, s.name, name_size );
+        out.name[ name_size - 1 ] = 0;
+        out.clock = s.clock;
+        uint32_t before, after, tries = 0;
+        do {
+            if ( ++tries > max_tries ) return false;
+            before = s.seq.load( std::memory_order_acquire );
+            out.stats.count = s.count.load( r );
+            out.stats.sum   = s.sum.load( r );
+            out.stats.sumsq = s.sumsq.load( r );
+            out.stats.min   = s.min.load( r );
+            out.stats.max   = s.max.load( r );
+            for ( unsigned b = 0; b < bucket_count; ++b )
+                out.buckets[ b ] = s.buckets[ b ].load( r );
+            std::atomic_thread_fence( std::memory_order_acquire );
+            after = s.seq.load( r );
+        } while ( ( before & 1 ) || before != after );
+        if ( out.stats.count == 0 ) out.stats.min = out.stats.max = 0;
+        return true;
+    }
+
+    //! @brief The writer's wall and process CPU time as of its last refresh, read together.
+    //  @return False if the writer died mid-refresh.
+    bool read( clocks &out ) const noexcept( true ) {
+        static constexpr auto r = std::memory_order_relaxed;
+        uint32_t before, after, tries = 0;
+        do {
+            if ( ++tries > max_tries ) return false;
+            before = hdr->seq.load( std::memory_order_acquire );
+            out.real_ns = hdr->real_ns.load( r );
+            out.cpu_ns  = hdr->cpu_ns.load( r );
+            std::atomic_thread_fence( std::memory_order_acquire );
+            after = hdr->seq.load( r );
+        } while ( ( before & 1 ) || before != after );
+        return true;
+    }
+
+  private:
+
+    // A writer holds a sequence number odd for well under a microsecond.
+    static constexpr unsigned max_tries = 1U << 20;
+
+    const char    *base       { nullptr };
+    size_t         map_size   {       0 };
+    const header  *hdr        { nullptr };
+    const slot    *slots      { nullptr };
+};
+
+}
+}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <type_traits>
+#include <utility>
+#include "sw_label.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+using label_id = ::wax::_impl::label::id_type;
+
+//! @brief One interval of a stopwatch::splits: the time from the previous split to this one.
+struct split {
+    label_id     id;        //< What the interval was.
+    int64_t      ns;        //< How long it took.
+};
+
+//! @brief One clock's part of a stopwatch::multi.
+struct reading {
+    clockid_t    clock;
+    int64_t      start;     //< Nanoseconds on that clock.
+    int64_t      ns;
+};
+
+//! @brief One event counted over a stopwatch::perf.
+struct counter {
+    const char  *name;      //< As perf(1) calls it, e.g. "instructions".
+    uint64_t     value;
+    label_id     id         { ::wax::_impl::label::none };  //< name interned, if it has been.
+};
+
+//! @brief What a set of readings says about how the time was spent.
+//
+// Wall time is the first reading on a clock that isn't a CPU clock, CPU time the first on
+// cpu::thread or else cpu::proc.  Either is 0 if there was no such reading.
+//
+struct derived {
+    int64_t      wall_ns        { 0 };
+    int64_t      cpu_ns         { 0 };
+    int64_t      off_cpu_ns     { 0 };      //< wall_ns - cpu_ns: waiting, blocked or preempted.
+    double       utilization    { 0 };      //< cpu_ns / wall_ns.  Past 1 for cpu::proc with
+                                            //  several threads.
+    bool         complete       { false };  //< There were both, so the rest means something.
+};
+
+//! @brief Everything a stopwatch hands to a sink when it stops.
+//
+// splits is only valid during the call to record(); a sink that wants them must copy them.
+//
+struct sample {
+    const char  *label;     //< Name of the stopwatch, or nullptr if it has only an id.
+    label_id     id;        //< Interned label, or label::none if it has only a name.
+    clockid_t    clock;     //< Clock the stopwatch ran on.
+    int64_t      start;     //< When it started, in nanoseconds on that clock.
+    int64_t      ns;        //< Elapsed time.
+    const split *splits        { nullptr };     //< Intervals within ns, oldest first.
+    uint32_t     split_count   {       0 };
+    const reading *readings    { nullptr };     //< Every clock of a multi, this one first.
+    uint32_t     reading_count {       0 };
+    const counter *counters    { nullptr };     //< Events counted over ns.
+    uint32_t     counter_count {       0 };
+    uint64_t     weight        {       1 };     //< Runs this one stands for; see sampled.
+    uint32_t     depth         {       0 };     //< Spans enclosing this one; see span.
+};
+
+//! @return Wall time, CPU time and what follows from them, from n readings.
+inline derived derive( const reading *r, uint32_t n ) noexcept( true ) {
+    derived d;
+    const reading *wall = nullptr, *thread = nullptr, *proc = nullptr;
+    for ( const reading *x = r; x < r + n; ++x ) {
+        const reading *&slot = x->clock == CLOCK_THREAD_CPUTIME_ID  ? thread
+                             : x->clock == CLOCK_PROCESS_CPUTIME_ID ? proc : wall;
+        if ( ! slot ) slot = x;
+    }
+    // Prefer the thread's CPU time; the process's includes other threads' work.
+    const reading *cpu = thread ? thread : proc;
+    if ( wall ) d.wall_ns = wall->ns;
+    if ( cpu )  d.cpu_ns  = cpu->ns;
+    if ( wall && cpu ) {
+        d.complete    = true;
+        d.off_cpu_ns  = wall->ns - cpu->ns;
+        d.utilization = wall->ns > 0 ? (double) cpu->ns / wall->ns : 0;
+    }
+    return d;
+}
+
+//! @brief True for types that can take samples: anything with record( const sample & ).
+template< typename sink_type, typename = void >
+struct is_sink : std::false_type {};
+
+template< typename sink_type >
+struct is_sink<
+    sink_type,
+    decltype( std::declval< sink_type & >().record( std::declval< const sample & >() ), void() ) >
+    : std::true_type {};
+
+//! @brief Non-owning, type-erased reference to a sink.
+//
+// Two pointers, so a stopwatch can be attached to any kind of sink without growing a member
+// per kind.  The referenced sink must outlive the stopwatch.
+//
+class sink_ref
+{
+  public:
+
+    constexpr sink_ref() noexcept( true ) = default;
+
+    template< typename sink_type,
+              typename std::enable_if< is_sink< sink_type >::value, int >::type = 0 >
+    sink_ref( sink_type &sink ) noexcept( true )
+        :
+        target( &sink ),
+        fn( []( void *target, const sample &s ) {
+                static_cast< sink_type * >( target )->record( s ); } )
+    {}
+
+    explicit operator bool() const noexcept( true ) { return fn != nullptr; }
+
+    void operator()( const sample &s ) const { fn( target, s ); }
+
+  private:
+
+    void  *target                           { nullptr };
+    void (*fn)( void *, const sample & )    { nullptr };
+};
+
+}
+}
+}
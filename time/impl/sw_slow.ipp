@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include "sw_base.ipp"
+#include "sw_disabled.ipp"
+#include "sw_histogram.ipp"
+#include "sw_rolling.ipp"
+#include "sw_thread.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief A time budget for stopwatch::slow, fixed or following a tail percentile.
+//
+// Long-lived and shared by every stopwatch checked against it.  In adaptive mode each timing it
+// sees also goes into a rolling histogram of the last second, and about ten times a second one
+// of the threads recording moves the budget to that second's percentile, or back down to the
+// floor given at construction if that is higher.  So however heavy the load, about 1 - pct / 100
+// of the timings exceed it.  The window is merged into a histogram allocated with the threshold,
+// so the thread that moves the budget never allocates; should a move still be running when the
+// next falls due, the later one is skipped.
+//
+class threshold
+{
+  public:
+
+    enum mode { fixed, adaptive };
+
+    //! @param budget_ns Timings at least this long exceed; in adaptive mode, the least budget.
+    //  @param pct       Percentile followed in adaptive mode.
+    explicit threshold( int64_t budget_ns, mode m = fixed, double pct = 99.9 )
+        :
+        floor( budget_ns ),
+        budget( budget_ns ),
+        pct( pct ),
+        recent( m == adaptive ? new window( window_ns / epochs ) : nullptr ),
+        scratch( m == adaptive ? new histogram : nullptr )
+    {}
+
+    threshold( const threshold & ) = delete;
+    threshold &operator=( const threshold & ) = delete;
+
+    //! @return True if a timing of ns exceeds the budget.  Counts it, in adaptive mode.
+    bool exceeded( int64_t ns ) noexcept( true ) {
+        if ( recent ) observe( ns );
+        return ns >= budget.load( std::memory_order_relaxed );
+    }
+
+    //! @return Current budget in nanoseconds.
+    int64_t budget_ns() const noexcept( true ) { return budget.load( std::memory_order_relaxed ); }
+
+    //! @brief Change the budget, or in adaptive mode the least it may be.
+    void set( int64_t ns ) noexcept( true ) {
+        floor.store( ns, std::memory_order_relaxed );
+        budget.store( ns, std::memory_order_relaxed );
+    }
+
+  private:
+
+    static constexpr unsigned epochs    = 4;
+    static constexpr int64_t  window_ns = 1000000000;
+    static constexpr int64_t  every_ns  = window_ns / 10;
+
+    using window = rolling< histogram, epochs >;
+
+    void observe( int64_t ns ) noexcept( true ) {
+        recent->record( ns );
+        const int64_t now  = clock::to_ns< clock::coarse >( clock::ticks< clock::coarse >() );
+        int64_t       next = due.load( std::memory_order_relaxed );
+        if ( __builtin_expect( now < next, 1 ) ) return;
+        if ( ! due.compare_exchange_strong( next, now + every_ns, std::memory_order_relaxed ) )
+            return;
+        if ( moving.test_and_set( std::memory_order_acquire ) ) return;
+        const int64_t p     = recent->percentile( pct, window_ns, *scratch );
+        moving.clear( std::memory_order_release );
+        const int64_t least = floor.load( std::memory_order_relaxed );
+        budget.store( p > least ? p : least, std::memory_order_relaxed );
+    }
+
+    std::atomic< int64_t >       floor;
+    std::atomic< int64_t >       budget;
+    const double                 pct;
+    std::unique_ptr< window >    recent;
+    std::unique_ptr< histogram > scratch;               //< Merged window, for the one moving.
+    std::atomic< int64_t >       due       { 0 };
+    std::atomic_flag             moving    = ATOMIC_FLAG_INIT;
+};
+
+//! @brief A stopwatch that reports only timings over a budget, with the thread and a context.
+//
+//  { stopwatch::slow< 5000000 > sw( "request", fd ); sw.context( request_id ); ... }
+//
+// The budget is the template parameter, or with 0 a threshold given first to the constructor.
+// On time, destruction reads the clock, compares, and forgets the descriptor and sink.  Over
+// budget, the sample goes out with counters for the thread's kernel id and, if set, the
+// context: indented lines under the time on the descriptor, sample::counters for a sink.
+//
+template< int64_t threshold_ns, clock::_hw_type clock_type >
+class slow : public base< clock_type >
+{
+  public:
+
+    template< typename... args >
+    explicit slow( args &&... a ) : base< clock_type >( std::forward< args >( a )... ) {
+        static_assert( threshold_ns > 0, "slow< 0 > takes a threshold first" );
+    }
+
+    template< typename... args >
+    explicit slow( threshold &t, args &&... a )
+        :
+        base< clock_type >( std::forward< args >( a )... ),
+        limit( &t )
+    {}
+
+    slow( const slow & ) = delete;
+    slow &operator=( const slow & ) = delete;
+
+    ~slow() {
+        if ( ! this->reporting() ) return;
+        const int64_t ns = this->lap_ns();
+        if ( __builtin_expect( ! over( ns ), 1 ) ) {
+            this->discard();
+            return;
+        }
+        const counter c[ 2 ] = { { "thread", ::wax::_impl::thread::id() }, { "context", user } };
+        sample s = this->summary( ns );
+        s.counters      = c;
+        s.counter_count = has_context ? 2 : 1;
+        this->finish( s );
+    }
+
+    //! @brief Something to report with the timing if it's slow, e.g. a request id.
+    void context( uint64_t value ) noexcept( true ) {
+        user        = value;
+        has_context = true;
+    }
+
+  private:
+
+    bool over( int64_t ns ) const noexcept( true ) {
+        if ( threshold_ns > 0 ) return ns >= threshold_ns;
+        return limit && limit->exceeded( ns );
+    }
+
+    threshold   *limit          { nullptr };
+    uint64_t     user           { 0 };
+    bool         has_context    { false };
+};
+
+//! @brief slow< threshold_ns, clock_type >, or disabled< clock_type > under
+//  WAX_STOPWATCH_DISABLE.
+#if defined( WAX_STOPWATCH_DISABLE )
+template< int64_t threshold_ns, clock::_hw_type clock_type >
+using enabled_slow = disabled< clock_type >;
+#else
+template< int64_t threshold_ns, clock::_hw_type clock_type >
+using enabled_slow = slow< threshold_ns, clock_type >;
+#endif
+
+}
+}
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <stdint.h>
+#include <unistd.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sw_base.ipp"
+#include "sw_label.ipp"
+#include "sw_thread.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief One thread's call tree of spans: which labels ran inside which, and for how long.
+//
+// Only the owning thread adds nodes or updates counts.  A node's label, parent and depth are
+// fixed before it is published through size(), so readers can walk [0, size()) at any time.
+// The last node is kept for overflow: once the others are taken, every new label path runs
+// there, under the root, and its time is counted once however the spans in it nest.
+//
+class span_tree
+{
+  public:
+
+    static constexpr uint32_t max_nodes = 1024;
+    static constexpr uint32_t root      = 0;
+    static constexpr uint32_t overflow  = max_nodes - 1;
+
+    struct node {
+        ::wax::_impl::label::id_type  label     { 0 };
+        uint32_t                      parent    { 0 };
+        uint32_t                      depth     { 0 };
+        uint32_t                      child     { 0 };      //< First child; owner only.
+        uint32_t                      sibling   { 0 };      //< Next sibling; owner only.
+        std::atomic< uint64_t >       count     { 0 };
+        std::atomic< int64_t  >       total     { 0 };
+        std::atomic< int64_t  >       self      { 0 };
+    };
+
+    span_tree() {
+        nodes[ overflow ].label = ::wax::_impl::label::intern( "<overflow>" );
+        nodes[ overflow ].depth = 1;
+    }
+
+    span_tree( const span_tree & ) = delete;
+    span_tree &operator=( const span_tree & ) = delete;
+
+    //! @return The child of parent carrying label, added if new; overflow once the tree is full.
+    uint32_t child( uint32_t parent, ::wax::_impl::label::id_type label ) noexcept( true ) {
+        uint32_t *link = &nodes[ parent ].child;
+        for ( ; *link; link = &nodes[ *link ].sibling )
+            if ( nodes[ *link ].label == label ) return *link;
+        const uint32_t n = used.load( std::memory_order_relaxed );
+        if ( n >= overflow ) {
+            if ( n == overflow ) used.store( max_nodes, std::memory_order_release );
+            return overflow;
+        }
+        nodes[ n ].label  = label;
+        nodes[ n ].parent = parent;
+        nodes[ n ].depth  = nodes[ parent ].depth + 1;
+        used.store( n + 1, std::memory_order_release );
+        *link = n;
+        return n;
+    }
+
+    //! @brief Owner only: count one run of node n.
+    void add( uint32_t n, int64_t total, int64_t self ) noexcept( true ) {
+        static constexpr auto r = std::memory_order_relaxed;
+        node &x = nodes[ n ];
+        x.count.store( x.count.load( r ) + 1, r );
+        x.total.store( x.total.load( r ) + total, r );
+        x.self.store( x.self.load( r ) + self, r );
+    }
+
+    uint32_t size() const noexcept( true ) { return used.load( std::memory_order_acquire ); }
+
+    const node &at( uint32_t n ) const noexcept( true ) { return nodes[ n ]; }
+
+    //! @return Labels from the root down to n, separated by ';'.
+    std::string path( uint32_t n ) const {
+        std::string p;
+        for ( ; n != root; n = nodes[ n ].parent ) {
+            const char *name = ::wax::_impl::label::name( nodes[ n ].label );
+            std::string part = name ? name : "<anon>";
+            p = p.empty() ? part : part + ";" + p;
+        }
+        return p;
+    }
+
+  private:
+
+    node                    nodes[ max_nodes ];
+    std::atomic< uint32_t > used    { 1 };
+};
+
+//! @brief A stopwatch that knows which span encloses it.
+//
+// Each thread keeps a stack of open spans per clock.  Opening one looks up its place in the
+// thread's call tree and pushes it; closing it charges the elapsed time to that node as total,
+// less whatever its children took as self, and pops it.  Constructor arguments are those of
+// base<>, so a span can also print or feed a sink.  Spans must close in the order they opened,
+// which scoping gives for free.
+//
+template <clock::_hw_type clock_type>
+class span : public base< clock_type >
+{
+  public:
+
+    template< typename... args >
+    explicit span( args &&... a )
+        :
+        base< clock_type >( std::forward< args >( a )... ),
+        parent( top() )
+    {
+        const auto id = this->label_id();
+        node = tree().child( parent ? parent->node : span_tree::root,
+                             id ? id : ::wax::_impl::label::intern( this->name() ) );
+        top() = this;
+    }
+
+    span( const span & ) = delete;
+    span &operator=( const span & ) = delete;
+
+    ~span() {
+        const int64_t total = this->lap_ns();
+        // A span overflowing inside another already has its total counted there.
+        const bool nested = parent && parent->node == node;
+        tree().add( node, nested ? 0 : total, total - children );
+        if ( parent ) parent->children += total;
+        top() = parent;
+        if ( ! this->reporting() ) return;
+        sample s = this->summary( total );
+        s.depth = depth();
+        this->finish( s );
+    }
+
+    //! @return This span's node in the calling thread's tree.
+    uint32_t id() const noexcept( true ) { return node; }
+
+    //! @return The enclosing span's node, or span_tree::root.
+    uint32_t parent_id() const noexcept( true ) { return tree().at( node ).parent; }
+
+    //! @return Number of spans enclosing this one; 0 in span_tree::overflow.
+    uint32_t depth() const noexcept( true ) { return tree().at( node ).depth - 1; }
+
+    //! @brief Write the call-tree profile, merged over all threads, one line per label path:
+    //
+    //  path count total_ns self_ns
+    //
+    //  Paths are labels from the outermost span in, separated by ';'.
+    //
+    static void report( int fd ) {
+        struct totals { uint64_t count; int64_t total; int64_t self; };
+        std::map< std::string, totals > merged;
+        {
+            auto &all = trees();
+            std::lock_guard< std::mutex > hold( all.lock );
+            for ( const span_tree *t : all.list ) {
+                if ( ! t ) continue;
+                for ( uint32_t n = 1, end = t->size(); n < end; ++n ) {
+                    const auto &x = t->at( n );
+                    auto &m = merged[ t->path( n ) ];
+                    m.count += x.count.load( std::memory_order_relaxed );
+                    m.total += x.total.load( std::memory_order_relaxed );
+                    m.self  += x.self.load( std::memory_order_relaxed );
+                }
+            }
+        }
+        std::string out;
+        for ( const auto &m : merged ) {
+            out += m.first;
+            out += ' ' + std::to_string( m.second.count ) + ' ' + std::to_string( m.second.total )
+                + ' ' + std::to_string( m.second.self ) + '\n';
+        }
+        for ( size_t off = 0; off < out.size(); ) {
+            const ssize_t n = ::write( fd, out.data() + off, out.size() - off );
+            if ( n <= 0 ) break;
+            off += n;
+        }
+    }
+
+  private:
+
+    struct tree_list {
+        std::mutex                    lock;
+        std::vector< span_tree * >    list;
+    };
+
+    //! @return Every thread's tree for this clock, indexed by thread ordinal.  Never destroyed.
+    static tree_list &trees() {
+        static tree_list *t = new tree_list;
+        return *t;
+    }
+
+    //! @return The calling thread's tree for this clock.
+    //
+    // Trees belong to thread ordinals rather than threads, so a new thread carries on an exited
+    // one's tree instead of leaking it; the report merges threads anyway.
+    //
+    static span_tree &tree() {
+        static thread_local span_tree *mine = nullptr;
+        if ( __builtin_expect( mine == nullptr, 0 ) ) {
+            const unsigned ord = ::wax::_impl::thread::ordinal();
+            auto &all = trees();
+            std::lock_guard< std::mutex > hold( all.lock );
+            if ( all.list.size() <= ord ) all.list.resize( ord + 1, nullptr );
+            if ( ! all.list[ ord ] ) all.list[ ord ] = new span_tree;
+            mine = all.list[ ord ];
+        }
+        return *mine;
+    }
+
+    static span *&top() {
+        static thread_local span *t = nullptr;
+        return t;
+    }
+
+    span        *parent;
+    uint32_t     node       { span_tree::root };
+    int64_t      children   { 0 };
+};
+
+}
+}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <utility>
+#include "sw_base.ipp"
+#include "sw_disabled.ipp"
+#include "sw_label.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief A stopwatch that also marks the end of each stage of the region it times.
+//
+//  stopwatch::splits< 4 > sw( h, WAX_STOPWATCH( "request" ) );
+//  parse();     sw.split( WAX_STOPWATCH( "parse" ) );
+//  plan();      sw.split( WAX_STOPWATCH( "plan" ) );
+//  execute();   sw.split( WAX_STOPWATCH( "execute" ) );
+//
+// A split is one clock read and two stores into an array inside the object.  Nothing is
+// converted or sent anywhere until the stopwatch goes out of scope; then the total and every
+// interval between splits go out as one sample, or as one line per split under the total.
+// Splits past capacity are ignored.
+//
+template< unsigned capacity, clock::_hw_type clock_type >
+class splits : public base< clock_type >
+{
+  public:
+
+    static_assert( capacity > 0, "splits needs room for at least one split" );
+
+    template< typename... args >
+    explicit splits( args &&... a ) : base< clock_type >( std::forward< args >( a )... ) {}
+
+    splits( const splits & ) = delete;
+    splits &operator=( const splits & ) = delete;
+
+    ~splits() {
+        clock::tick_type prev = this->started();
+        const int64_t    ns   = this->lap_ns();
+        // Turn readings into intervals in place.
+        for ( uint32_t i = 0; i < used; ++i ) {
+            const clock::tick_type at = points[ i ].ns;
+            points[ i ].ns = clock::to_ns< clock_type >( at - prev );
+            prev = at;
+        }
+        this->finish( ns, points, used );
+    }
+
+    //! @brief End the stage called id: the time since the last split, or since reset().
+    void split( stopwatch::label_id id ) noexcept( true ) {
+        if ( __builtin_expect( used == capacity, 0 ) ) return;
+        points[ used ].id = id;
+        points[ used ].ns = clock::ticks< clock_type >();
+        ++used;
+    }
+
+    void split( ::wax::_impl::label::handle label ) noexcept( true ) { split( label.id ); }
+
+    //! @return Splits taken so far.
+    uint32_t size() const noexcept( true ) { return used; }
+
+    //! @brief Reset the clock and forget the splits.
+    //  @return 0 on success, -1 on failure.  Errno set to cause of failure.
+    int reset() noexcept( true ) {
+        used = 0;
+        return base< clock_type >::reset();
+    }
+
+  private:
+
+    uint32_t          used    { 0 };
+    stopwatch::split  points[ capacity ];   //< Readings in ticks until the destructor converts.
+};
+
+//! @brief splits< capacity, clock_type >, or disabled< clock_type > under WAX_STOPWATCH_DISABLE.
+#if defined( WAX_STOPWATCH_DISABLE )
+template< unsigned capacity, clock::_hw_type clock_type >
+using enabled_splits = disabled< clock_type >;
+#else
+template< unsigned capacity, clock::_hw_type clock_type >
+using enabled_splits = splits< capacity, clock_type >;
+#endif
+
+}
+}
+}
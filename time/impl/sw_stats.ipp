@@ -0,0 +1,272 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "sw_accumulator.ipp"
+#include "sw_histogram.ipp"
+#include "sw_trace.ipp"
+
+//! @brief Compile a stats kernel for AVX-512 and AVX2 as well as the baseline, picked at load.
+//
+// Elsewhere the baseline is vector code already: NEON on aarch64, SSE2 on x86-64.
+//
+#if defined( __x86_64__ ) && defined( __GNUC__ ) && defined( __ELF__ )
+#define WAX_STATS_KERNEL \
+    __attribute__(( target_clones( "arch=x86-64-v4", "arch=x86-64-v3", "default" ) ))
+#else
+#define WAX_STATS_KERNEL
+#endif
+
+namespace wax {
+namespace _impl {
+
+//! @namespace stats
+//  @brief Offline statistics over large sets of recorded timings.
+//
+// Every function takes either a plain array of nanoseconds or a trace::view, read where it is
+// mapped: entries are scanned in place as four 64-bit words, of which the third is the duration,
+// with no copying or decoding.  Trace entries never completed are skipped, as are entries for
+// other labels when a label is given.
+//
+// The kernels keep eight independent lanes of every running value, so the compiler turns the
+// inner loop into vector code whatever the width, without being allowed to reassociate floating
+// point.  Work is cut into one contiguous part per thread and the parts merged; threads = 0 means
+// one per core.
+//
+namespace stats {
+
+using moments   = ::wax::_impl::stopwatch::moments;
+using histogram = ::wax::_impl::stopwatch::histogram;
+using label_id  = ::wax::_impl::label::id_type;
+
+namespace _impl {
+
+static constexpr unsigned lanes = 8;
+
+// Bucket number meaning "not a sample": one past the histogram's last.
+static constexpr unsigned skip = histogram::bucket_count;
+
+//! @brief A plain array of nanoseconds.
+struct array {
+    const int64_t  *ns;
+
+    int64_t value( size_t i ) const noexcept( true ) { return ns[ i ]; }
+    bool    valid( size_t )   const noexcept( true ) { return true; }
+};
+
+//! @brief Trace entries, as raw words.
+struct entries {
+    const uint64_t *words;
+    label_id        label;      //< Only this label, or label::none for all.
+
+    static constexpr unsigned stride = sizeof( ::wax::_impl::trace::entry ) / sizeof( uint64_t );
+
+    int64_t value( size_t i ) const noexcept( true ) { return (int64_t) words[ i * stride + 2 ]; }
+    bool    valid( size_t i ) const noexcept( true ) {
+        // seq is the low half of word 0, the label the high half of word 3.
+        const uint64_t w3 = words[ i * stride + 3 ];
+        return ( (uint32_t) words[ i * stride ] != 0 )
+               & ( ( label == ::wax::_impl::label::none ) | ( (uint32_t) ( w3 >> 32 ) == label ) );
+    }
+};
+
+static_assert( sizeof( ::wax::_impl::trace::entry ) == 4 * sizeof( uint64_t ),
+               "stats reads trace entries as four words" );
+
+inline entries of( const ::wax::_impl::trace::view &v, label_id label ) noexcept( true ) {
+    return entries { reinterpret_cast< const uint64_t * >( v.data() ), label };
+}
+
+//! @return Slots of a trace worth scanning: all of them once the ring has wrapped.
+inline size_t extent( const ::wax::_impl::trace::view &v ) noexcept( true ) {
+    const uint64_t n = v.end();
+    return n < v.info().capacity ? n : v.info().capacity;
+}
+
+template< typename source >
+WAX_STATS_KERNEL
+moments summarize( source src, size_t begin, size_t end ) noexcept( true ) {
+    uint64_t  count[ lanes ] = {};
+    int64_t   sum[ lanes ]   = {};
+    double    sumsq[ lanes ] = {};
+    int64_t   lo[ lanes ], hi[ lanes ];
+    for ( unsigned j = 0; j < lanes; ++j ) {
+        lo[ j ] = std::numeric_limits< int64_t >::max();
+        hi[ j ] = std::numeric_limits< int64_t >::min();
+    }
+    size_t i = begin;
+    for ( ; i + lanes <= end; i += lanes ) {
+        for ( unsigned j = 0; j < lanes; ++j ) {
+            const int64_t v  = src.value( i + j );
+            const bool    ok = src.valid( i + j );
+            count[ j ] += ok;
+            sum[ j ]   += ok ? v : 0;
+            sumsq[ j ] += ok ? (double) v * v : 0.0;
+            lo[ j ]     = ok && v < lo[ j ] ? v : lo[ j ];
+            hi[ j ]     = ok && v > hi[ j ] ? v : hi[ j ];
+        }
+    }
+    for ( unsigned j = 0; i < end; ++i, ++j ) {
+        const int64_t v = src.value( i );
+        if ( ! src.valid( i ) ) continue;
+        ++count[ j ];
+        sum[ j ]   += v;
+        sumsq[ j ] += (double) v * v;
+        lo[ j ]     = std::min( lo[ j ], v );
+        hi[ j ]     = std::max( hi[ j ], v );
+    }
+    moments m;
+    for ( unsigned j = 0; j < lanes; ++j )
+        m.merge( moments { count[ j ], sum[ j ], sumsq[ j ], lo[ j ], hi[ j ] } );
+    return m;
+}
+
+//! @brief Bucket numbers for up to block samples from begin; skip for those that aren't.
+template< typename source >
+WAX_STATS_KERNEL
+void index( source src, size_t begin, size_t n, uint16_t *out ) noexcept( true ) {
+    for ( size_t i = 0; i < n; ++i ) {
+        const uint16_t b = histogram::index( src.value( begin + i ) );
+        out[ i ] = src.valid( begin + i ) ? b : skip;
+    }
+}
+
+static_assert( skip <= std::numeric_limits< uint16_t >::max(), "bucket numbers fit 16 bits" );
+
+//! @brief Add counts per bucket, plus one slot for skips, for samples in [begin, end).
+template< typename source >
+void bucket( source src, size_t begin, size_t end, uint64_t *counts ) noexcept( true ) {
+    static constexpr size_t block = 1024;
+    uint16_t b[ block ];
+    while ( begin < end ) {
+        const size_t n = std::min( block, end - begin );
+        index( src, begin, n, b );
+        for ( size_t i = 0; i < n; ++i ) ++counts[ b[ i ] ];
+        begin += n;
+    }
+}
+
+//! @brief Call f( part, begin, end ) on one thread per part of [0, n), and wait for them all.
+template< typename fn_type >
+void parallel( size_t n, unsigned threads, fn_type &&f ) {
+    if ( threads == 0 ) threads = std::max( 1U, std::thread::hardware_concurrency() );
+    // Parts smaller than this aren't worth a thread.
+    static constexpr size_t least = 1 << 16;
+    threads = (unsigned) std::max< size_t >( 1, std::min< size_t >( threads, n / least ) );
+    const size_t part = ( n + threads - 1 ) / threads;
+    std::vector< std::thread > pool;
+    for ( unsigned t = 1; t < threads; ++t )
+        pool.emplace_back( [ &f, t, part, n ] {
+            f( t, std::min( n, t * part ), std::min( n, ( t + 1 ) * part ) ); } );
+    f( 0U, 0, std::min( n, part ) );
+    for ( auto &t : pool ) t.join();
+}
+
+template< typename source >
+moments summarize( source src, size_t n, unsigned threads ) {
+    std::vector< moments > parts( threads ? threads
+                                          : std::max( 1U, std::thread::hardware_concurrency() ) );
+    parallel( n, threads, [ & ]( unsigned t, size_t b, size_t e ) {
+        parts[ t ] = summarize( src, b, e ); } );
+    moments m;
+    for ( const auto &p : parts ) m.merge( p );
+    return m;
+}
+
+template< typename source >
+void bucket( source src, size_t n, histogram &out, unsigned threads ) {
+    const unsigned width = threads ? threads : std::max( 1U, std::thread::hardware_concurrency() );
+    std::vector< uint64_t > counts( (size_t) width * ( skip + 1 ) );
+    parallel( n, threads, [ & ]( unsigned t, size_t b, size_t e ) {
+        bucket( src, b, e, &counts[ (size_t) t * ( skip + 1 ) ] ); } );
+    for ( unsigned i = 0; i < skip; ++i ) {
+        uint64_t c = 0;
+        for ( unsigned t = 0; t < width; ++t ) c += counts[ (size_t) t * ( skip + 1 ) + i ];
+        if ( c ) out.record( histogram::lowest( i ), c );
+    }
+}
+
+// Bucket everything to find the one bucket the rank falls in, then select within just that
+// bucket's samples, gathered in parallel.  Two passes over the data and no copy of all of it.
+// A trace still being written can change between the passes, so the second may find fewer
+// samples in the bucket than the first counted; the rank is then clamped to what it found.
+template< typename source >
+int64_t quantile( source src, size_t n, double pct, unsigned threads ) {
+    histogram *h = new histogram;
+    bucket( src, n, *h, threads );
+    const uint64_t total = h->count();
+    if ( total == 0 ) {
+        delete h;
+        return 0;
+    }
+    uint64_t rank = (uint64_t) ( pct / 100.0 * total + 0.5 );
+    if ( rank < 1 ) rank = 1;
+    if ( rank > total ) rank = total;
+    unsigned target = 0;
+    uint64_t below  = 0;
+    for ( ; target < histogram::bucket_count - 1; ++target ) {
+        const uint64_t c = h->at( target );
+        if ( below + c >= rank ) break;
+        below += c;
+    }
+    delete h;
+
+    const unsigned width = threads ? threads : std::max( 1U, std::thread::hardware_concurrency() );
+    std::vector< std::vector< int64_t > > found( width );
+    parallel( n, threads, [ & ]( unsigned t, size_t b, size_t e ) {
+        for ( size_t i = b; i < e; ++i ) {
+            const int64_t v = src.value( i );
+            if ( src.valid( i ) && histogram::index( v ) == target ) found[ t ].push_back( v );
+        }
+    } );
+    std::vector< int64_t > &all = found[ 0 ];
+    for ( unsigned t = 1; t < width; ++t ) all.insert( all.end(), found[ t ].begin(),
+                                                       found[ t ].end() );
+    if ( all.empty() ) return histogram::lowest( target );
+    const size_t k = std::min< size_t >( rank - below - 1, all.size() - 1 );
+    std::nth_element( all.begin(), all.begin() + k, all.end() );
+    return all[ k ];
+}
+
+}
+
+//! @return Count, sum, sum of squares, min and max of n values.
+inline moments summarize( const int64_t *ns, size_t n, unsigned threads = 1 ) {
+    return _impl::summarize( _impl::array { ns }, n, threads );
+}
+
+//! @return The same over a trace, for one label or for all.
+inline moments summarize( const ::wax::_impl::trace::view &v,
+                          label_id label = ::wax::_impl::label::none, unsigned threads = 1 ) {
+    return _impl::summarize( _impl::of( v, label ), _impl::extent( v ), threads );
+}
+
+//! @brief Count n values into a histogram, which may already hold others.  Quantiles then come
+//  from out.percentile(), to within a bucket; histograms from several sources merge().
+inline void bucket( const int64_t *ns, size_t n, histogram &out, unsigned threads = 1 ) {
+    _impl::bucket( _impl::array { ns }, n, out, threads );
+}
+
+inline void bucket( const ::wax::_impl::trace::view &v, histogram &out,
+                    label_id label = ::wax::_impl::label::none, unsigned threads = 1 ) {
+    _impl::bucket( _impl::of( v, label ), _impl::extent( v ), out, threads );
+}
+
+//! @return The exact value at or below which pct percent of the values fall, by the same rank
+//  as histogram::percentile(); 0 if there are none.
+inline int64_t quantile( const int64_t *ns, size_t n, double pct, unsigned threads = 1 ) {
+    return _impl::quantile( _impl::array { ns }, n, pct, threads );
+}
+
+inline int64_t quantile( const ::wax::_impl::trace::view &v, double pct,
+                         label_id label = ::wax::_impl::label::none, unsigned threads = 1 ) {
+    return _impl::quantile( _impl::of( v, label ), _impl::extent( v ), pct, threads );
+}
+
+}
+}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <utility>
+#include "sw_base.ipp"
+#include "sw_disabled.ipp"
+#include "sw_label.ipp"
+
+namespace wax {
+namespace _impl {
+namespace stopwatch {
+
+//! @brief A stopwatch for a task that suspends and may resume on another thread.
+//
+// Lives in the task's own state, e.g. the coroutine frame or promise, rather than on a stack.
+// Whoever runs the task calls resume() when it starts running on a thread and suspend() when it
+// gives the thread up, on that same thread; resumed<> does both for a scope.  Each stretch adds
+// its wall time on clock_type and its thread CPU time, so the CPU figure is right however often
+// the task moves.  The task itself never runs on two threads at once, and the executor's hand-off
+// orders one stretch before the next, so nothing here is atomic.
+//
+// On completion, or destruction if sooner, the total from construction goes out with splits for
+// the active and suspended time, readings for active wall time and CPU time, and a count of
+// resumes.
+//
+template <clock::_hw_type clock_type>
+class task : public base< clock_type >
+{
+  public:
+
+    template< typename... args >
+    explicit task( args &&... a ) : base< clock_type >( std::forward< args >( a )... ) {}
+
+    task( const task & ) = delete;
+    task &operator=( const task & ) = delete;
+
+    ~task() { complete(); }
+
+    //! @brief The task is running on the calling thread from now.
+    //
+    // The calling thread may be new to the task-clock, so its page is opened before the wall
+    // clock is read rather than inside the stretch.
+    //
+    void resume() noexcept( true ) {
+        if ( running ) return;
+        clock::warm< clock::cpu::thread >();
+        clock::warm< clock_type >();
+        wall_at = clock::ticks< clock_type >();
+        cpu_at  = clock::ticks< clock::cpu::thread >();
+        running = true;
+        ++runs;
+    }
+
+    //! @brief The task has stopped running on the calling thread.
+    void suspend() noexcept( true ) {
+        if ( ! running ) return;
+        cpu    += clock::ticks< clock::cpu::thread >() - cpu_at;
+        active += clock::ticks< clock_type >() - wall_at;
+        running = false;
+    }
+
+    //! @brief Stop, and report if there is a sink or descriptor.  Later calls do nothing.
+    void complete() {
+        suspend();
+        if ( ! this->reporting() ) return;
+        const int64_t total   = this->lap_ns();
+        const int64_t busy    = active_ns();
+        static const ::wax::_impl::label::handle names[ 2 ] = {
+            ::wax::_impl::label::handle::of( "active" ),
+            ::wax::_impl::label::handle::of( "suspended" ) };
+        const split   parts[ 2 ] = { { names[ 0 ].id, busy }, { names[ 1 ].id, total - busy } };
+        const reading r[ 2 ]     = {
+            { clock_type, clock::timestamp< clock_type >( this->started() ), busy },
+            { clock::cpu::thread, 0, cpu_ns() } };
+        const counter n[ 1 ]     = { { "resumes", runs } };
+        sample s = this->summary( total );
+        s.splits        = parts;
+        s.split_count   = 2;
+        s.readings      = r;
+        s.reading_count = 2;
+        s.counters      = n;
+        s.counter_count = 1;
+        this->finish( s );
+    }
+
+    //! @return Wall time spent running so far, not counting a stretch still in progress.
+    int64_t active_ns() const noexcept( true ) { return clock::to_ns< clock_type >( active ); }
+
+    //! @return Thread CPU time spent running so far, likewise.
+    int64_t cpu_ns() const noexcept( true ) { return clock::to_ns< clock::cpu::thread >( cpu ); }
+
+    //! @return Times resumed.
+    uint64_t resumes() const noexcept( true ) { return runs; }
+
+  private:
+
+    clock::tick_type  wall_at   { 0 };
+    clock::tick_type  cpu_at    { 0 };
+    clock::tick_type  active    { 0 };
+    clock::tick_type  cpu       { 0 };
+    uint64_t          runs      { 0 };
+    bool              running   { false };
+};
+
+//! @brief Resume a task stopwatch for the life of a scope.
+template< typename task_type >
+class resumed
+{
+  public:
+
+    explicit resumed( task_type &t ) noexcept( true ) : t( t ) { t.resume(); }
+    ~resumed() { t.suspend(); }
+
+    resumed( const resumed & ) = delete;
+    resumed &operator=( const resumed & ) = delete;
+
+  private:
+
+    task_type &t;
+};
+
+}
+}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "sw_config.hpp"
+#include "sw_tsc.ipp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace taskclock
+//  @brief The calling thread's CPU time without a system call, where the kernel allows it.
+//
+// CLOCK_THREAD_CPUTIME_ID has no vDSO path, so every read is a real system call.  Instead each
+// thread opens a perf task-clock event on itself, the first time it asks, and maps the event's
+// control page.  The kernel keeps time_enabled there, the thread's time on CPU as of its last
+// switch in, with the conversion from the cycle counter to the time since; one read of the
+// counter under the page's sequence lock then gives the time now.  That needs user-readable
+// time on the page (cap_user_time), which depends on the kernel trusting the counter: many VMs
+// don't.  Where any of this is missing the thread falls back to clock_gettime() for good.
+//
+// Readings are offset to agree with CLOCK_THREAD_CPUTIME_ID when the page is opened, so the
+// two can be mixed.  A forked child reopens rather than read its parent's page.
+//
+namespace taskclock {
+
+namespace _impl {
+
+//! @return Count of forks in this process's ancestry since it first opened a page.  Read and
+//  bumped with the __atomic builtins.
+inline unsigned &forks() noexcept( true ) {
+    static unsigned n = 0;
+    return n;
+}
+
+inline int64_t syscall_ns() noexcept( true ) {
+    struct timespec ts { 0, 0 };
+    (void) ::clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+//! @brief Read the page.
+//  @return False if it doesn't carry user-readable time, now or any more.
+inline bool read_page( const volatile struct perf_event_mmap_page *pc,
+                       int64_t &ns ) noexcept( true ) {
+#if defined( __x86_64__ ) || defined( __i386__ )
+    uint32_t seq;
+    uint64_t enabled, offset, cycles;
+    uint32_t mult;
+    uint16_t shift;
+    do {
+        seq = pc->lock;
+        asm volatile( "" : : : "memory" );
+        if ( ! pc->cap_user_time ) return false;
+        enabled = pc->time_enabled;
+        offset  = pc->time_offset;
+        mult    = pc->time_mult;
+        shift   = pc->time_shift;
+        cycles  = ::wax::_impl::tsc::cycles();
+        asm volatile( "" : : : "memory" );
+    } while ( pc->lock != seq );
+    // As in <linux/perf_event.h>: split the product so that it can't overflow.
+    const uint64_t quot = cycles >> shift;
+    const uint64_t rem  = cycles & ( ( 1ULL << shift ) - 1 );
+    ns = (int64_t) ( enabled + offset + quot * mult + ( ( rem * mult ) >> shift ) );
+    return true;
+#else
+    (void) pc;
+    (void) ns;
+    return false;
+#endif
+}
+
+//! @brief One thread's page.
+class page
+{
+  public:
+
+    page() = default;
+    page( const page & ) = delete;
+    page &operator=( const page & ) = delete;
+
+    ~page() { close(); }
+
+    //! @return The thread's CPU time in nanoseconds.
+    int64_t now() noexcept( true ) {
+        if ( __builtin_expect( generation != __atomic_load_n( &forks(), __ATOMIC_RELAXED ), 0 ) )
+            open();
+        int64_t ns;
+        if ( __builtin_expect( pc != nullptr, 1 ) && read_page( pc, ns ) ) return ns + origin;
+        return syscall_ns();
+    }
+
+    //! @return True if this thread reads the page rather than making a system call.
+    bool direct() noexcept( true ) {
+        (void) now();
+        return pc != nullptr;
+    }
+
+  private:
+
+    //! @brief Map the page, after a fork too; leaves pc null if that can't be done.
+    void open() noexcept( true );
+
+    void close() noexcept( true );
+
+    const volatile struct perf_event_mmap_page  *pc          { nullptr };
+    size_t                                       size        {       0 };
+    int64_t                                      origin      {       0 };
+    unsigned                                     generation  {     ~0U };  //< Never matches first.
+};
+
+inline page &local() noexcept( true ) {
+    static thread_local page p;
+    return p;
+}
+
+}
+
+//! @return The calling thread's CPU time in nanoseconds, as CLOCK_THREAD_CPUTIME_ID.
+inline int64_t now() noexcept( true ) { return _impl::local().now(); }
+
+inline int gettime( struct timespec *ts ) noexcept( true ) {
+    const int64_t ns = now();
+    ts->tv_sec  = ns / 1000000000L;
+    ts->tv_nsec = ns % 1000000000L;
+    return 0;
+}
+
+//! @return True if the calling thread's CPU time reads without a system call.
+inline bool direct() noexcept( true ) { return _impl::local().direct(); }
+
+//! @return The calling thread's CPU time by clock_gettime(), for comparison.
+inline int64_t syscall_ns() noexcept( true ) { return _impl::syscall_ns(); }
+
+}
+}
+}
+
+#if ! defined( WAX_STOPWATCH_LIBRARY )
+#include "lib/sw_taskclock.ipp"
+#endif
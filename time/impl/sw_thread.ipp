@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <mutex>
+#include <vector>
+
+namespace wax {
+namespace _impl {
+
+//! @brief Size to pad per-thread data to, so that writers on different cores don't share lines.
+static constexpr unsigned cache_line = 64;
+
+namespace thread {
+
+namespace _impl {
+
+//! @brief Hands out small dense thread ordinals and takes them back when threads exit.
+class ordinals
+{
+  public:
+
+    unsigned acquire() {
+        std::lock_guard< std::mutex > hold( lock );
+        if ( released.empty() ) return next++;
+        const unsigned id = released.back();
+        released.pop_back();
+        return id;
+    }
+
+    void release( unsigned id ) {
+        std::lock_guard< std::mutex > hold( lock );
+        released.push_back( id );
+    }
+
+    //! @return The process-wide pool.  Never destroyed, so it outlives every thread_local.
+    static ordinals &pool() {
+        static ordinals *p = new ordinals;
+        return *p;
+    }
+
+  private:
+
+    std::mutex              lock;
+    std::vector< unsigned > released;
+    unsigned                next      { 0 };
+};
+
+//! @brief Returns this thread's ordinal to the pool when the thread exits.
+struct ordinal_holder {
+    const unsigned id { ordinals::pool().acquire() };
+    ~ordinal_holder() { ordinals::pool().release( id ); }
+};
+
+// A plain thread-local int on the fast path; the holder, which needs a guarded constructor and
+// an exit-time destructor, is only touched on a thread's first call.
+inline thread_local unsigned cached_ordinal = ~0U;
+
+}
+
+//! @return A small index for the calling thread, unique among live threads.
+//
+// Ordinals are dense from zero and are reused once their thread exits, so they suit indexing
+// fixed per-thread arrays.
+//
+inline unsigned ordinal() noexcept( true ) {
+    if ( __builtin_expect( _impl::cached_ordinal == ~0U, 0 ) ) {
+        static thread_local _impl::ordinal_holder holder;
+        _impl::cached_ordinal = holder.id;
+    }
+    return _impl::cached_ordinal;
+}
+
+//! @return The kernel's id for the calling thread, as shown by ps -L and in /proc.
+inline uint32_t id() noexcept( true ) {
+    static thread_local uint32_t tid = 0;
+    if ( __builtin_expect( tid == 0, 0 ) ) tid = (uint32_t) ::syscall( SYS_gettid );
+    return tid;
+}
+
+}
+}
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include "sw_label.ipp"
+#include "sw_sink.ipp"
+#include "sw_thread.ipp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace trace
+//  @brief Memory-mapped binary log of every sample: the layout shared by writer and readers.
+//
+//  [ header | label table | entries ... ]
+//
+// Entries form a ring of fixed 32-byte records.  A writer claims one with a single fetch_add on
+// header::next and marks it complete by storing the low 32 bits of its index + 1 in seq.  The
+// file is mapped shared, so whatever was written is in the page cache even if the process dies.
+//
+namespace trace {
+
+static constexpr char      magic[ 8 ]    = { 'W', 'A', 'X', 'T', 'R', 'A', 'C', 'E' };
+static constexpr uint32_t  version       = 1;
+static constexpr uint64_t  header_size   = 4096;
+static constexpr uint64_t  labels_size   = 256 * 1024;
+
+struct header {
+    char                     magic[ 8 ];
+    uint32_t                 version;
+    uint32_t                 entry_size;
+    uint64_t                 capacity;          //< Entries in the ring; a power of 2.
+    uint64_t                 labels_offset;
+    uint64_t                 labels_size;
+    uint64_t                 entries_offset;
+    int64_t                  realtime_offset;   //< CLOCK_REALTIME - CLOCK_MONOTONIC when opened.
+    uint32_t                 pid;
+    uint32_t                 reserved;
+    std::atomic< uint64_t >  next;              //< Entries ever claimed.
+    std::atomic< uint64_t >  labels_used;       //< Bytes of the label table written.
+};
+
+//! @brief One sample.  Times are nanoseconds on the entry's clock.
+struct entry {
+    std::atomic< uint32_t >  seq;       //< Low bits of index + 1 once complete, 0 while written.
+    int32_t                  clock;
+    int64_t                  start;
+    int64_t                  ns;
+    uint32_t                 tid;
+    uint32_t                 label;     //< Id in the label table, or 0.
+};
+
+//! @brief One entry, as a reader copied it.
+struct event {
+    int32_t                  clock;
+    int64_t                  start;
+    int64_t                  ns;
+    uint32_t                 tid;
+    uint32_t                 label;
+};
+
+//! @brief Label table record, followed by len bytes of name.  Records are 4-byte aligned.
+struct label_record {
+    uint32_t  id;
+    uint32_t  len;
+};
+
+static_assert( sizeof( entry ) == 32, "trace entries are 32 bytes" );
+static_assert( sizeof( header ) <= header_size, "trace header must fit its page" );
+static_assert( std::atomic< uint64_t >::is_always_lock_free,
+               "trace counters must be usable across processes" );
+
+//! @brief Writer side: a stopwatch sink appending every sample to a trace file.
+//
+// Descriptor and mapping are set up by the constructor; if that failed is_open() is false,
+// errno says why, and samples are discarded.
+//
+class file
+{
+  public:
+
+    //! @param path     File to create or truncate.
+    //  @param capacity Entries kept before the oldest are overwritten.  Rounded up to a power
+    //                  of two; the default makes a 32 MB file.
+    explicit file( const char *path, uint64_t capacity = 1UL << 20 ) noexcept( true ) {
+        uint64_t cap = 1;
+        while ( cap < capacity ) cap <<= 1;
+        map_size = header_size + labels_size + cap * sizeof( entry );
+
+        const int fd = ::open( path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+        if ( fd < 0 ) return;
+        if ( ::ftruncate( fd, map_size ) == 0 ) {
+            void *p = ::mmap( nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+            if ( p != MAP_FAILED ) base = static_cast< char * >( p );
+        }
+        const int saved = errno;
+        ::close( fd );
+        errno = saved;
+        if ( ! base ) return;
+
+        struct timespec real { 0, 0 }, mono { 0, 0 };
+        (void) ::clock_gettime( CLOCK_REALTIME,  &real );
+        (void) ::clock_gettime( CLOCK_MONOTONIC, &mono );
+
+        hdr = new ( base ) header;
+        ::memcpy( hdr->magic, magic, sizeof magic );
+        hdr->version          = version;
+        hdr->entry_size       = sizeof( entry );
+        hdr->capacity         = cap;
+        hdr->labels_offset    = header_size;
+        hdr->labels_size      = labels_size;
+        hdr->entries_offset   = header_size + labels_size;
+        hdr->realtime_offset  = ( real.tv_sec - mono.tv_sec ) * 1000000000L
+                              + ( real.tv_nsec - mono.tv_nsec );
+        hdr->pid              = (uint32_t) ::getpid();
+        hdr->next.store( 0, std::memory_order_relaxed );
+        hdr->labels_used.store( 0, std::memory_order_release );
+        entries = reinterpret_cast< entry * >( base + hdr->entries_offset );
+    }
+
+    file( const file & ) = delete;
+    file &operator=( const file & ) = delete;
+
+    ~file() {
+        if ( base ) ::munmap( base, map_size );
+    }
+
+    bool is_open() const noexcept( true ) { return base != nullptr; }
+
+    //! @brief Sink interface.  No syscalls once the label and thread have been seen.
+    void record( const ::wax::_impl::stopwatch::sample &s ) noexcept( true ) {
+        if ( ! base ) return;
+        const auto id = s.id ? s.id : ::wax::_impl::label::intern( s.label );
+        if ( __builtin_expect( id > labels_done.load( std::memory_order_acquire ), 0 ) )
+            publish_labels();
+
+        const uint64_t i = hdr->next.fetch_add( 1, std::memory_order_relaxed );
+        entry &e = entries[ i & ( hdr->capacity - 1 ) ];
+        e.seq.store( 0, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        e.clock = s.clock;
+        e.start = s.start;
+        e.ns    = s.ns;
+        e.tid   = ::wax::_impl::thread::id();
+        e.label = id;
+        e.seq.store( (uint32_t) ( i + 1 ), std::memory_order_release );
+    }
+
+  private:
+
+    //! @brief Copy names new to the label registry into the file.
+    void publish_labels() noexcept( true ) {
+        std::lock_guard< std::mutex > hold( labels_lock );
+        const auto last = ::wax::_impl::label::last();
+        auto       done = labels_done.load( std::memory_order_relaxed );
+        uint64_t   used = hdr->labels_used.load( std::memory_order_relaxed );
+        char      *table = base + hdr->labels_offset;
+        for ( ; done < last; ++done ) {
+            const char    *name = ::wax::_impl::label::name( done + 1 );
+            const uint32_t len  = (uint32_t) ::strlen( name );
+            const uint64_t need = ( sizeof( label_record ) + len + 3 ) & ~3UL;
+            if ( used + need > hdr->labels_size ) break;
+            const label_record rec { done + 1, len };
+            ::memcpy( table + used, &rec, sizeof rec );
+            ::memcpy( table + used + sizeof rec, name, len );
+            used += need;
+        }
+        hdr->labels_used.store( used, std::memory_order_release );
+        // A full table still counts as done, so the hot path stops coming here.
+        labels_done.store( last, std::memory_order_release );
+    }
+
+    char                   *base          { nullptr };
+    size_t                  map_size      {       0 };
+    header                 *hdr           { nullptr };
+    entry                  *entries       { nullptr };
+    std::mutex              labels_lock;
+    std::atomic< uint32_t > labels_done   {       0 };
+};
+
+//! @brief Reader side: maps a trace file read-only.
+class view
+{
+  public:
+
+    explicit view( const char *path ) noexcept( true ) {
+        const int fd = ::open( path, O_RDONLY | O_CLOEXEC );
+        if ( fd < 0 ) return;
+        struct stat st;
+        if ( ::fstat( fd, &st ) == 0 && (uint64_t) st.st_size >= header_size ) {
+            void *p = ::mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+            if ( p != MAP_FAILED ) {
+                base     = static_cast< const char * >( p );
+                map_size = st.st_size;
+            }
+        }
+        const int saved = errno;
+        ::close( fd );
+        errno = saved;
+        if ( ! base ) return;
+
+        hdr = reinterpret_cast< const header * >( base );
+        if ( ::memcmp( hdr->magic, magic, sizeof magic ) != 0 || hdr->version != version
+             || hdr->entry_size != sizeof( entry )
+             || hdr->entries_offset + hdr->capacity * sizeof( entry ) > map_size
+             || hdr->labels_offset + hdr->labels_size > hdr->entries_offset ) {
+            ::munmap( const_cast< char * >( base ), map_size );
+            base  = nullptr;
+            hdr   = nullptr;
+            errno = EINVAL;
+            return;
+        }
+        entries = reinterpret_cast< const entry * >( base + hdr->entries_offset );
+    }
+
+    view( const view & ) = delete;
+    view &operator=( const view & ) = delete;
+
+    ~view() {
+        if ( base ) ::munmap( const_cast< char * >( base ), map_size );
+    }
+
+    bool is_open() const noexcept( true ) { return base != nullptr; }
+
+    const header &info() const noexcept( true ) { return *hdr; }
+
+    //! @return Index of the oldest entry still in the ring.
+    uint64_t first() const noexcept( true ) {
+        const uint64_t n = end();
+        return n > hdr->capacity ? n - hdr->capacity : 0;
+    }
+
+    //! @return One past the index of the newest entry.
+    uint64_t end() const noexcept( true ) {
+        return hdr->next.load( std::memory_order_acquire );
+    }
+
+    //! @brief Copy the entry at index i, consistently.
+    //  @return False if it was never completed, or has been or is being overwritten.
+    //
+    // The sequence number is checked again after the copy: a writer that lapped the ring in
+    // between leaves a different one, and the entry for i is gone, so there is nothing to retry.
+    //
+    bool read( uint64_t i, event &out ) const noexcept( true ) {
+        const entry   &e    = entries[ i & ( hdr->capacity - 1 ) ];
+        const uint32_t want = (uint32_t) ( i + 1 );
+        if ( e.seq.load( std::memory_order_acquire ) != want ) return false;
+        out.clock = e.clock;
+        out.start = e.start;
+        out.ns    = e.ns;
+        out.tid   = e.tid;
+        out.label = e.label;
+        std::atomic_thread_fence( std::memory_order_acquire );
+        return e.seq.load( std::memory_order_relaxed ) == want;
+    }
+
+    //! @return All entry slots, complete or not, in ring order; for bulk scans.
+    const entry *data() const noexcept( true ) { return entries; }
+
+    //! @brief Call f( id, name, len ) for every label in the file.
+    template< typename fn_type >
+    void each_label( fn_type &&f ) const {
+        const char    *table = base + hdr->labels_offset;
+        const uint64_t used  = hdr->labels_used.load( std::memory_order_acquire );
+        for ( uint64_t off = 0; off + sizeof( label_record ) <= used; ) {
+            label_record rec;
+            ::memcpy( &rec, table + off, sizeof rec );
+            if ( off + sizeof rec + rec.len > used ) break;
+            f( rec.id, table + off + sizeof rec, rec.len );
+            off += ( sizeof rec + rec.len + 3 ) & ~3UL;
+        }
+    }
+
+  private:
+
+    const char    *base       { nullptr };
+    size_t         map_size   {       0 };
+    const header  *hdr        { nullptr };
+    const entry   *entries    { nullptr };
+};
+
+}
+}
+}
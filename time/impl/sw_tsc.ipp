@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include "sw_config.hpp"
+
+namespace wax {
+namespace _impl {
+
+//! @namespace tsc
+//  @brief Cycle-counter time source, calibrated against CLOCK_MONOTONIC_RAW.
+//
+// Reading the counter is a single unprivileged instruction, which makes it several times cheaper
+// than even a vDSO clock_gettime().  It is only used when the counter ticks at a constant rate
+// regardless of P-/C-state and is synchronized across cores; otherwise every read falls back to
+// CLOCK_MONOTONIC_RAW.
+//
+namespace tsc {
+
+//! @brief Conversion from counter cycles to CLOCK_MONOTONIC_RAW nanoseconds.
+//
+//  ns = base_ns + ( ( cycles - base_cycles ) * mult ) >> shift
+//
+// When the counter isn't usable, ticks are CLOCK_MONOTONIC_RAW nanoseconds and mult/shift are
+// left as the identity, so converting a duration never needs a branch.
+//
+struct calibration {
+    bool      usable       {       false };
+    uint64_t  base_cycles  {           0 };
+    int64_t   base_ns      {           0 };
+    uint64_t  mult         { 1UL << 32   };
+    unsigned  shift        {          32 };
+};
+
+//! @return The raw counter value.  Only meaningful when calibrated().usable is set.
+inline uint64_t cycles() noexcept( true ) {
+#if defined( __x86_64__ ) || defined( __i386__ )
+    unsigned aux;
+    return __builtin_ia32_rdtscp( &aux );
+#elif defined( __aarch64__ )
+    uint64_t v;
+    asm volatile( "isb; mrs %0, cntvct_el0" : "=r" ( v ) :: "memory" );
+    return v;
+#else
+    return 0;
+#endif
+}
+
+namespace _impl {
+
+inline int64_t raw_ns() noexcept( true ) {
+    struct timespec now { 0, 0 };
+    (void) ::clock_gettime( CLOCK_MONOTONIC_RAW, &now );
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+//! @brief Check the counter and measure its rate, spinning for about 10 ms.
+WAX_STOPWATCH_API calibration calibrate() noexcept( true );
+
+}
+
+//! @return The process-wide calibration, computed on first use.
+//
+// Deliberately not static: an inline function's local statics are shared by every translation
+// unit, so the calibration spin happens once per process rather than once per includer.
+//
+inline const calibration &calibrated() noexcept( true ) {
+    static const calibration c = _impl::calibrate();
+    return c;
+}
+
+//! @return Nanoseconds on the CLOCK_MONOTONIC_RAW timeline for a counter value.
+inline int64_t to_ns( const calibration &c, uint64_t cyc ) noexcept( true ) {
+    return c.base_ns
+        + (int64_t) ( ( (unsigned __int128) ( cyc - c.base_cycles ) * c.mult ) >> c.shift );
+}
+
+//! @return Nanoseconds in a span of ticks.
+inline int64_t elapsed_ns( int64_t ticks ) noexcept( true ) {
+    const auto &c = calibrated();
+    return (int64_t) ( ( (__int128) ticks * c.mult ) >> c.shift );
+}
+
+//! @return Nanoseconds on the CLOCK_MONOTONIC_RAW timeline for a reading from ticks().
+inline int64_t timestamp( int64_t ticks ) noexcept( true ) {
+    const auto &c = calibrated();
+    return c.usable ? to_ns( c, ticks ) : ticks;
+}
+
+//! @return The counter, or CLOCK_MONOTONIC_RAW nanoseconds where the counter isn't usable.
+inline int64_t ticks() noexcept( true ) {
+    return calibrated().usable ? (int64_t) cycles() : _impl::raw_ns();
+}
+
+//! @return Nanoseconds now on the CLOCK_MONOTONIC_RAW timeline.
+inline int64_t now() noexcept( true ) {
+    const auto &c = calibrated();
+    return c.usable ? to_ns( c, cycles() ) : _impl::raw_ns();
+}
+
+//! @brief clock_gettime() workalike for the counter.
+//  @return 0 on success, -1 on failure.  Errno set to cause of failure.
+inline int gettime( struct timespec *ts ) noexcept( true ) {
+    const auto &c = calibrated();
+    if ( ! c.usable ) return ::clock_gettime( CLOCK_MONOTONIC_RAW, ts );
+    const int64_t ns = to_ns( c, cycles() );
+    ts->tv_sec  = ns / 1000000000L;
+    ts->tv_nsec = ns % 1000000000L;
+    return 0;
+}
+
+//! @brief clock_getres() workalike for the counter.
+//
+// A cycle is well under a nanosecond on anything this runs on, so the reported grain is the
+// nanosecond that timespec can carry.
+//
+inline int getres( struct timespec *res ) noexcept( true ) {
+    if ( ! calibrated().usable ) return ::clock_getres( CLOCK_MONOTONIC_RAW, res );
+    res->tv_sec  = 0;
+    res->tv_nsec = 1;
+    return 0;
+}
+
+}
+}
+}
+
+#if ! defined( WAX_STOPWATCH_LIBRARY )
+#include "lib/sw_tsc.ipp"
+#endif
@@ -0,0 +1,15 @@
+//! @file stopwatch.cpp
+//  @brief The compiled runtime, libwax_stopwatch: what the headers leave out under
+//  WAX_STOPWATCH_LIBRARY.
+//
+//  The label table, the report queue and its thread, the cycle-counter calibration and the
+//  task-clock page setup, each defined here once rather than inline in every includer.
+//
+#if ! defined( WAX_STOPWATCH_LIBRARY )
+#define WAX_STOPWATCH_LIBRARY
+#endif
+
+#include "../impl/lib/sw_label.ipp"
+#include "../impl/lib/sw_report.ipp"
+#include "../impl/lib/sw_taskclock.ipp"
+#include "../impl/lib/sw_tsc.ipp"
@@ -1,34 +1,446 @@
 #pragma once
 
-#include <stdio.h>
-#include <utility>
-#include <vector>
+#include "clock.hpp"
 #include "impl/sw_base.ipp"
+#include "impl/sw_disabled.ipp"
+#include "impl/sw_histogram.ipp"
+#include "impl/sw_accumulator.ipp"
+#include "impl/sw_trace.ipp"
+#include "impl/sw_span.ipp"
+#include "impl/sw_split.ipp"
+#include "impl/sw_accumulating.ipp"
+#include "impl/sw_multi.ipp"
+#include "impl/sw_perf.ipp"
+#include "impl/sw_sampled.ipp"
+#include "impl/sw_metrics.ipp"
+#include "impl/sw_task.ipp"
+#include "impl/sw_registry.ipp"
+#include "impl/sw_stats.ipp"
+#include "impl/sw_rolling.ipp"
+#include "impl/sw_slow.ipp"
+#include "impl/sw_shm.ipp"
+#include "impl/sw_chrome.ipp"
 
 namespace wax {
 
 //! @namespace stopwatch
 //  @brief Real and process-time stopwatches with scoping semantics.
 //
+//  Build with WAX_STOPWATCH_DISABLE defined, for the whole program, to turn every stopwatch into
+//  an empty no-op with the same interface.  Sinks stay as they are; nothing records into them.
+//
+//  Build with WAX_STOPWATCH_LIBRARY defined, likewise for the whole program, and link
+//  libwax_stopwatch to compile the label table, report thread and clock calibration once
+//  instead of in every includer; the wax::stopwatch CMake target does both.  clock.hpp alone
+//  has the clocks with none of the rest.
+//
 namespace stopwatch {
 
-namespace clock {
-    using type = ::wax::_impl::clock::_hw_type;
-    static constexpr     type real    = ::wax::_impl::clock::real;
-    namespace cpu {
-        static constexpr type thread  = ::wax::_impl::clock::cpu::thread;
-        static constexpr type proc    = ::wax::_impl::clock::cpu::proc;
-    }
-}
-
 //! @class stopwatch::real
+//! @class stopwatch::monotonic
+//! @class stopwatch::monotonic_raw
+//! @class stopwatch::coarse
+//! @class stopwatch::boottime
 //! @class stopwatch::cpu::thread
 //! @class stopwatch::cpu::proc
+//! @class stopwatch::tsc
+//
+//  Typical cost of one read on x86-64 Linux, and the grain res() reports:
+//
+//    real           CLOCK_REALTIME            vDSO, ~20 ns     1 ns  Slewed and stepped by NTP.
+//    monotonic      CLOCK_MONOTONIC           vDSO, ~20 ns     1 ns  Slewed, never stepped.
+//    monotonic_raw  CLOCK_MONOTONIC_RAW       vDSO, ~20 ns     1 ns  Unadjusted hardware rate.
+//                                                                    (A syscall before 5.3.)
+//    coarse         CLOCK_MONOTONIC_COARSE    vDSO,  ~5 ns  1-4 ms  Last tick; grain is 1/HZ.
+//    boottime       CLOCK_BOOTTIME            vDSO, ~20 ns     1 ns  Monotonic, counts suspend.
+//    cpu::thread    CLOCK_THREAD_CPUTIME_ID   page, ~15 ns     1 ns  On-CPU time of this thread.
+//                                             (else syscall, 200+ ns)
+//    cpu::proc      CLOCK_PROCESS_CPUTIME_ID  syscall, 200+ ns 1 ns  On-CPU time of all threads.
+//    tsc            rdtscp / cntvct_el0       ~7 ns            1 ns  See below.
+//
+//  Use monotonic for latency; real only when the timestamps have to line up with wall time.
+//
+//  overhead_ns() is what a reset() and lap cost on the clock itself, measured during static
+//  initialization for every clock it is used with; lap_corrected() takes it off.  Worth it for
+//  regions of a microsecond or less.
+//
+//  stopwatch::tsc reads the CPU cycle counter, calibrated once per process against
+//  CLOCK_MONOTONIC_RAW.  Where the counter isn't invariant it quietly reads CLOCK_MONOTONIC_RAW
+//  instead.
+//
+//  cpu::thread reads the thread's time from a perf task-clock page and the cycle counter where
+//  the kernel publishes user-readable time there; many VMs don't, and then it is the system
+//  call.  Both count from the same origin.  taskclock::direct() says which this thread gets.
 
-using real = ::wax::_impl::stopwatch::base< clock::real >;
+using real          = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::base,
+                                                        clock::real          >;
+using monotonic     = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::base,
+                                                        clock::monotonic     >;
+using monotonic_raw = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::base,
+                                                        clock::monotonic_raw >;
+using coarse        = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::base,
+                                                        clock::coarse        >;
+using boottime      = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::base,
+                                                        clock::boottime      >;
+using tsc           = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::base,
+                                                        clock::tsc           >;
 namespace cpu {
-    using thread = ::wax::_impl::stopwatch::base< clock::cpu::thread >;
-    using proc   = ::wax::_impl::stopwatch::base< clock::cpu::proc   >;
+    using thread = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::base,
+                                                     clock::cpu::thread >;
+    using proc   = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::base,
+                                                     clock::cpu::proc   >;
 }
+
+//! @class stopwatch::lite
+//
+//  Eight bytes of start time, in ticks, on any of the clocks above, e.g.
+//  lite< clock::monotonic >.  No label, no output, no constructor work; reset() before use.
+
+template< clock::type clock_type >
+using lite = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::lite, clock_type >;
+
+//! @class stopwatch::label
+//
+//  A stopwatch name interned to a 32-bit id.  Pass one wherever a const char * label goes; the
+//  stopwatch then carries only the id, and sinks aggregate on it without hashing strings.
+//  WAX_STOPWATCH( "name" ) makes one at static-initialization time; label::of( name ) at run
+//  time.
+
+using label    = ::wax::_impl::label::handle;
+using label_id = ::wax::_impl::label::id_type;
+
+//! @class stopwatch::histogram
+//
+//  Latency distribution to about 1%, from 1 ns to hours.  Any stopwatch constructed against one
+//  records its final lap there instead of printing it:
+//
+//      static stopwatch::histogram h;
+//      { stopwatch::monotonic sw( h ); ... }
+//      h.p99();
+
+using histogram = ::wax::_impl::stopwatch::histogram;
+
+//! @class stopwatch::accumulator
+//
+//  Count, sum, sum of squares, min and max, sharded per thread so that many threads timing the
+//  same region never contend.  Attach stopwatches the same way as to a histogram; read with
+//  snapshot(), which returns stopwatch::moments.
+
+using accumulator = ::wax::_impl::stopwatch::accumulator;
+using moments     = ::wax::_impl::stopwatch::moments;
+
+//! @class stopwatch::registry
+//
+//  Count, sum and max for every label, for thousands of long-lived labels such as one per
+//  endpoint and shard.  One arena holds a cache-aligned array per field, indexed by label id:
+//
+//      static stopwatch::registry timers( 8192 );
+//      { stopwatch::monotonic sw( timers, endpoint_label ); ... }
+//      timers.snapshot( counts, sums, nullptr );       // timers.size() of each
+//
+//  Ids past the capacity given at construction are counted in dropped() and otherwise ignored.
+
+using registry = ::wax::_impl::stopwatch::registry;
+
+//! @class stopwatch::rolling
+//
+//  A histogram or accumulator per epoch, in a ring, for statistics over the recent past rather
+//  than since start:
+//
+//      static stopwatch::rolling< stopwatch::histogram, 60 > recent;     // 60 epochs of 1 s
+//      { stopwatch::monotonic sw( recent ); ... }
+//      recent.percentile( 99.0, 60000000000 );                            // p99, last minute
+//
+//  A record finds its epoch with one coarse clock read and stores no timestamp.  Epochs rotate
+//  without locks; windows are whole epochs, including the one in progress.  Rings of
+//  accumulators answer snapshot( window_ns ); each( window_ns, f ) visits the epochs directly.
+
+template< typename aggregate, unsigned epochs = 60 >
+using rolling = ::wax::_impl::stopwatch::rolling< aggregate, epochs >;
+
+//! @class stopwatch::trace_file
+//
+//  Every sample, binary, in a memory-mapped ring file: start, duration, thread id, label and
+//  clock.  Recording is one fetch_add and a few stores.  Decode with tools/sw_trace_decode.
+
+using trace_file = ::wax::_impl::trace::file;
+using trace_view = ::wax::_impl::trace::view;
+
+//! @class stopwatch::shared_segment
+//
+//  Per-label, per-clock count, sum, min, max and histogram in a named shm_open(3) segment, for
+//  a sidecar process to read without asking:
+//
+//      static stopwatch::shared_segment shared( "/wax.worker.3" );
+//      { stopwatch::monotonic sw( shared, "request" ); ... }
+//
+//  and in the reader, stopwatch::shared_view v( "/wax.worker.3" ), then v.read( i, totals ) for
+//  each i below v.size(), totals.clock saying which clock a slot's times are on, so that a
+//  stopwatch::real and a stopwatch::cpu::proc under one label are two slots.  v.read( clocks )
+//  gives the writer's CLOCK_REALTIME and CLOCK_PROCESS_CPUTIME_ID, refreshed together every
+//  100 ms.  The layout is fixed and versioned; every read is a consistent snapshot under the
+//  slot's sequence number.
+
+using shared_segment = ::wax::_impl::shm::segment;
+using shared_view    = ::wax::_impl::shm::view;
+using shared_totals  = ::wax::_impl::shm::totals;
+using shared_clocks  = ::wax::_impl::shm::clocks;
+
+//! @class stopwatch::chrome_trace
+//
+//  A sink writing every sample as a Chrome trace event, to open in chrome://tracing or
+//  ui.perfetto.dev:
+//
+//      static stopwatch::chrome_trace trace( "run.json" );
+//      { stopwatch::span req( trace, "request" ); { stopwatch::span p( trace, "parse" ); ... } }
+//
+//  Each thread's events go into a chunk of its own; a background thread formats whatever has
+//  been recorded every 50 ms and appends it as the run goes, out of a fixed pool of chunks, so
+//  memory stays bounded.  Spans nest by time on each thread's track and carry their depth.
+//  dropped() counts events lost when the writer fell behind.  The JSON is closed off at
+//  destruction or close().
+
+using chrome_trace = ::wax::_impl::chrome::writer;
+
+//! @namespace stopwatch::stats
+//
+//  Min, max, mean and variance, histograms and exact quantiles over many recorded timings, from
+//  an array or straight from a mapped trace file:
+//
+//      stopwatch::trace_view v( "run.trace" );
+//      auto m = stopwatch::stats::summarize( v, label, 0 );      // 0: a thread per core
+//      stopwatch::stats::quantile( v, 99.9, label, 0 );
+//
+//  The loops vectorize: AVX-512 or AVX2 chosen at load time on x86-64, NEON on aarch64.
+//  bucket() fills a stopwatch::histogram for approximate quantiles; quantile() is exact, and
+//  selects within the one histogram bucket holding the rank rather than sorting everything.
+
+namespace stats = ::wax::_impl::stats;
+
+//! @class stopwatch::span
+//
+//  A monotonic stopwatch that attributes its time to a per-thread call tree of labels, split
+//  into self and total.  span::report( fd ) writes the tree merged over all threads:
+//
+//      { stopwatch::span req( "request" ); { stopwatch::span p( "parse" ); ... } ... }
+//
+//  Spans on other clocks are span_on< clock >; each clock keeps its own tree.  A thread's tree
+//  holds span_tree::max_nodes label paths; paths beyond that are counted together as
+//  "<overflow>".
+
+using span = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::span, clock::monotonic >;
+template< clock::type clock_type >
+using span_on = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::span, clock_type >;
+
+//! @class stopwatch::splits
+//
+//  One stopwatch timing the stages of a region, with no allocation: split( label ) ends the
+//  stage so far with one clock read.  On scope exit the total and the stages go out together,
+//  to a sink as sample::splits, or as indented lines under the total:
+//
+//      stopwatch::splits< 4 > sw( "request", fd );
+//      parse();  sw.split( WAX_STOPWATCH( "parse" ) );
+//      plan();   sw.split( WAX_STOPWATCH( "plan" ) );
+//
+//  capacity is the most splits kept; the clock defaults to monotonic.
+
+template< unsigned capacity, clock::type clock_type = clock::monotonic >
+using splits = ::wax::_impl::stopwatch::enabled_splits< capacity, clock_type >;
+
+//! @class stopwatch::accumulating
+//
+//  A stopwatch on any clock that counts only while running, for regions broken up by waits:
+//  pause() and resume() are one clock read each.  Timing the same region with one on
+//  clock::monotonic and one on clock::cpu::thread gives wall time against time on the CPU.
+
+template< clock::type clock_type >
+using accumulating = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::accumulating,
+                                                       clock_type >;
+
+//! @class stopwatch::multi
+//
+//  Several clocks over one region in one object, read back to back, reported together:
+//
+//      stopwatch::multi< clock::monotonic, clock::cpu::thread > sw( "handler", fd );
+//
+//  prints the monotonic time, then the thread's CPU time, the off-CPU time (wall less CPU:
+//  blocked, waiting or preempted) and the utilization.  A sink gets every clock in
+//  sample::readings; stopwatch::derive() works out the rest, as metrics() does while running.
+
+template< clock::type first, clock::type... rest >
+using multi = ::wax::_impl::stopwatch::enabled_multi< first, rest... >;
+
+using reading = ::wax::_impl::stopwatch::reading;
+using derived = ::wax::_impl::stopwatch::derived;
+
+//! @return Wall time, CPU time, off-CPU time and utilization from a multi's readings:
+//  derive( const reading *r, uint32_t n ).
+using ::wax::_impl::stopwatch::derive;
+
+namespace event {
+    using type = ::wax::_impl::pmu::event;
+    static constexpr type cycles           = ::wax::_impl::pmu::cycles;
+    static constexpr type instructions     = ::wax::_impl::pmu::instructions;
+    static constexpr type llc_misses       = ::wax::_impl::pmu::llc_misses;
+    static constexpr type branch_misses    = ::wax::_impl::pmu::branch_misses;
+    static constexpr type context_switches = ::wax::_impl::pmu::context_switches;
+    static constexpr type page_faults      = ::wax::_impl::pmu::page_faults;
 }
+
+//! @class stopwatch::perf
+//
+//  A cpu::thread stopwatch that also counts hardware or kernel events over its region:
+//
+//      stopwatch::perf< event::cycles, event::instructions > sw( "hot", fd );
+//
+//  prints the CPU time and then a line per event; instructions over cycles is the IPC.  A sink
+//  gets the counts in sample::counters.  The thread's counter group opens on first use and
+//  stays open.  Reads are rdpmc where allowed, else one read(2) per start and stop.  Without
+//  a PMU (many VMs) or with perf_event_paranoid above 2, available() is false and only the
+//  time is reported.
+
+template< event::type... events >
+using perf = ::wax::_impl::stopwatch::enabled_perf< events... >;
+using counter = ::wax::_impl::stopwatch::counter;
+
+//! @class stopwatch::sampled
+//
+//  For paths too hot to time every call: times about one run in n, picked by a per-thread
+//  countdown with a random gap, and on the rest reads no clock at all.  Each timed run records
+//  with weight n, so a histogram or accumulator behind it counts every call:
+//
+//      static stopwatch::histogram h;
+//      void hot() { stopwatch::sampled< 100 > sw( h ); ... }
+//
+//  The clock defaults to monotonic.  The countdown is shared by every sampled< n, clock > on
+//  the thread, which keeps each site's share fair on average.
+
+template< unsigned n, clock::type clock_type = clock::monotonic >
+using sampled = ::wax::_impl::stopwatch::enabled_sampled< n, clock_type >;
+
+//! @class stopwatch::slow
+//
+//  Reports only the outliers: timings at or over a budget, with the thread id and an optional
+//  context value.  On time it costs the clock read and a compare.
+//
+//      { stopwatch::slow< 5000000 > sw( "request", fd ); sw.context( id ); ... }   // 5 ms
+//
+//      static stopwatch::threshold tail( 1000000, stopwatch::threshold::adaptive );
+//      { stopwatch::slow<> sw( tail, "request", fd ); ... }
+//
+//  A threshold is a budget that can change at run time; an adaptive one follows the p99.9 of
+//  the last second, never below the budget it was given, so output stays about one line per
+//  thousand timings however slow things get.
+
+template< int64_t threshold_ns = 0, clock::type clock_type = clock::monotonic >
+using slow = ::wax::_impl::stopwatch::enabled_slow< threshold_ns, clock_type >;
+using threshold = ::wax::_impl::stopwatch::threshold;
+
+//! @class stopwatch::metric
+//! @class stopwatch::exporter
+//
+//  Aggregates for scraping.  A metric is a histogram and an accumulator registered under a
+//  label; any stopwatch can record into it.  Existing ones can be registered with
+//  export_as().  openmetrics() appends everything registered in OpenMetrics text, for a pull
+//  callback; an exporter serves the same over HTTP from its own thread:
+//
+//      static stopwatch::metric parse( WAX_STOPWATCH( "parse" ) );
+//      { stopwatch::monotonic sw( parse ); ... }
+//
+//      stopwatch::exporter http( 9464 );           // GET http://127.0.0.1:9464/metrics
+//
+//  Scrapes read histograms and accumulators as their own readers do, without stopping writers.
+//  A metric stops being exported when destroyed; anything given to export_as() needs an
+//  unexport() first.
+
+using metric   = ::wax::_impl::stopwatch::metric;
+using exporter = ::wax::_impl::metrics::listener;
+
+//! @class stopwatch::task
+//
+//  For work that suspends and resumes, possibly on another thread: a coroutine, or a task on
+//  a work-stealing executor.  Keep it in the task's state and bracket every stretch of running:
+//
+//      struct request { stopwatch::task sw { "request", fd }; ... };
+//      { stopwatch::resumed< stopwatch::task > run( req.sw ); ... }   // on whichever thread
+//
+//  Each stretch reads the wall clock and that thread's CPU clock on entry and exit.  On
+//  completion it reports total time, split into active and suspended, with the CPU time, the
+//  off-CPU time while active, and the number of resumes.  task_on< clock > picks the wall
+//  clock; the default is monotonic.
+
+using task = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::task, clock::monotonic >;
+template< clock::type clock_type >
+using task_on = ::wax::_impl::stopwatch::enabled< ::wax::_impl::stopwatch::task, clock_type >;
+template< typename task_type >
+using resumed = ::wax::_impl::stopwatch::resumed< task_type >;
+
+//! @brief Register a histogram or accumulator for export under label, until unexport().
+//  @return False if the export table is full.
+template< typename aggregate >
+inline bool export_as( label l, const aggregate &a ) { return ::wax::_impl::metrics::add( l, a ); }
+
+//! @brief Stop exporting a histogram or accumulator; call before destroying one given to
+//  export_as().  Waits for a scrape that may be reading it.
+template< typename aggregate >
+inline void unexport( const aggregate &a ) { ::wax::_impl::metrics::remove( a ); }
+
+//! @brief Append every registered aggregate to out as OpenMetrics text, ending "# EOF".
+inline void openmetrics( std::string &out, const char *prefix = "wax_stopwatch" ) {
+    ::wax::_impl::metrics::openmetrics( out, prefix );
 }
+
+//! @brief Write out every line queued by stopwatches given a file descriptor.
+//
+//  Lines are written by a background thread every few milliseconds and at exit; call this when
+//  they have to be out sooner, e.g. before fork() or _exit().  A descriptor handed to a
+//  stopwatch must stay open until then: close it only after a flush() that follows the last
+//  stopwatch using it.
+//
+inline void flush() { ::wax::_impl::report::flush(); }
+
+//! @return Lines lost so far because a thread finished stopwatches faster than they could be
+//  written.  Each thread queues up to 4096; past that lines are dropped rather than making the
+//  timed code wait, and the total is printed to standard error at exit if it isn't 0.
+inline uint64_t dropped() { return ::wax::_impl::report::dropped(); }
+
+//! @brief Chars format() may write.
+static constexpr size_t format_size = ::wax::_impl::format::max_duration;
+
+//! @brief Write a duration as text in the unit its size suits, e.g. "12.34 μs", with no digits
+//  finer than res.  Used for the lines stopwatches print.
+//
+//  @param buf At least format_size chars.
+//  @param ns  Duration in nanoseconds.
+//  @param res Resolution to show, in nanoseconds; typically the stopwatch's res().
+//  @return One past the last char written.  Not nul-terminated.
+//
+inline char *format( char *buf, int64_t ns, unsigned long res = 1 ) noexcept( true ) {
+    return ::wax::_impl::format::duration( buf, ns, res );
+}
+
+//! @brief As above, always in unit, e.g. format< res::usec >( buf, sw.lap_ns(), sw.res() ).
+//  The unit and its suffix are settled at compile time.
+template< unsigned unit >
+inline char *format( char *buf, int64_t ns, unsigned long res = 1 ) noexcept( true ) {
+    return ::wax::_impl::format::duration< unit >( buf, ns, res );
+}
+}
+}
+
+//! @brief A stopwatch::label for a string literal, interned once during static initialization.
+//
+//  stopwatch::monotonic sw( WAX_STOPWATCH( "parse" ) );
+//
+//  Each use site registers its own label type, so at run time this is a load from a global.
+//  Stopwatches built during static initialization from another translation unit may see
+//  label::none.
+//
+#if defined( WAX_STOPWATCH_DISABLE )
+#define WAX_STOPWATCH( name ) ( ::wax::stopwatch::label {} )
+#else
+#define WAX_STOPWATCH( name )                                                                     \
+    ( [] {                                                                                        \
+        struct wax_stopwatch_label { static constexpr const char *text() { return name; } };     \
+        return ::wax::_impl::label::registered< wax_stopwatch_label >::value; }() )
+#endif
@@ -0,0 +1,60 @@
+//! @file accumulating.cpp
+//  @brief accumulating counts only the stretches between resume() and pause().
+//
+#include <time.h>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace {
+
+void sleep_ms( long ms ) {
+    struct timespec t { ms / 1000, ms % 1000 * 1000000L };
+    while ( ::nanosleep( &t, &t ) != 0 ) {}
+}
+
+void spin_ms( long ms ) {
+    wax::stopwatch::monotonic sw;
+    while ( sw.lap_ns() < ms * 1000000L ) {}
+}
+
+}
+
+int main() {
+    wax::stopwatch::accumulating< wax::stopwatch::clock::monotonic > sw;
+    CHECK( ! sw.paused() );
+
+    spin_ms( 5 );
+    sw.pause();
+    CHECK( sw.paused() );
+    const int64_t first = sw.lap_ns();
+    CHECK( first >= 5000000 );
+
+    // Paused: nothing counts, and pausing again changes nothing.
+    sleep_ms( 50 );
+    sw.pause();
+    CHECK( sw.lap_ns() == first );
+
+    sw.resume();
+    sw.resume();
+    CHECK( ! sw.paused() );
+    spin_ms( 5 );
+    sw.pause();
+    const int64_t both = sw.lap_ns();
+    CHECK( both >= first + 5000000 );
+    CHECK( both < first + 40000000 );
+    CHECK( sw.lap< std::chrono::nanoseconds >().count() == both );
+
+    // Two stretches, so two clock reads' worth of overhead come off.
+    const int64_t overhead = sw.overhead_ns();
+    CHECK( overhead >= 0 );
+    const int64_t expect = both - 2 * overhead;
+    CHECK( sw.lap_corrected() == ( expect > 0 ? expect : 0 ) );
+
+    CHECK( sw.reset() == 0 );
+    CHECK( ! sw.paused() );
+    CHECK( sw.lap_ns() < first );
+    sw.pause();
+    const int64_t lap = sw.lap_ns();
+    CHECK( sw.lap_corrected() == ( lap > overhead ? lap - overhead : 0 ) );
+    return checks::failed();
+}
@@ -0,0 +1,29 @@
+//! @file check.hpp
+//  @brief Just enough of a test harness: CHECK() reports what failed and counts it, and
+//  main() returns checks::failed() for ctest.
+//
+#pragma once
+
+#include <stdio.h>
+
+namespace checks {
+
+inline int &failures() {
+    static int n = 0;
+    return n;
+}
+
+inline bool check( bool ok, const char *what, const char *file, int line ) {
+    if ( ! ok ) {
+        fprintf( stderr, "%s:%d: CHECK( %s ) failed\n", file, line, what );
+        ++failures();
+    }
+    return ok;
+}
+
+//! @return 1 if any check failed, else 0.
+inline int failed() { return failures() ? 1 : 0; }
+
+}
+
+#define CHECK( x ) ::checks::check( ( x ), #x, __FILE__, __LINE__ )
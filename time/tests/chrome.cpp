@@ -0,0 +1,76 @@
+//! @file chrome.cpp
+//  @brief A chrome_trace capture from several threads has every event, and is well formed.
+//
+//  chrome [ path ]
+//
+//  The capture is left at path for the chrome_json test to parse as JSON; without a path it
+//  goes to a temporary file and is removed.
+//
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace {
+
+static constexpr int threads = 4;
+static constexpr int spans   = 5000;      //< Per thread, each with one inside it.
+
+std::string slurp( const char *path ) {
+    std::string s;
+    if ( FILE *f = ::fopen( path, "r" ) ) {
+        char buf[ 65536 ];
+        for ( size_t n; ( n = ::fread( buf, 1, sizeof buf, f ) ) > 0; ) s.append( buf, n );
+        ::fclose( f );
+    }
+    return s;
+}
+
+size_t occurrences( const std::string &s, const char *what ) {
+    size_t n = 0;
+    for ( size_t at = s.find( what ); at != std::string::npos; at = s.find( what, at + 1 ) ) ++n;
+    return n;
+}
+
+}
+
+int main( int argc, char **argv ) {
+    const std::string path = argc > 1 ? argv[ 1 ]
+                           : "/tmp/wax_test_chrome." + std::to_string( ::getpid() ) + ".json";
+    uint64_t dropped = 0;
+    {
+        wax::stopwatch::chrome_trace trace( path.c_str() );
+        CHECK( trace.is_open() );
+        std::vector< std::thread > pool;
+        for ( int t = 0; t < threads; ++t )
+            pool.emplace_back( [ &trace ] {
+                for ( int i = 0; i < spans; ++i ) {
+                    wax::stopwatch::span outer( trace, "request \"quoted\"" );
+                    wax::stopwatch::span inner( trace, "parse\\path" );
+                }
+                // CPU-time clocks have no timeline and are left out.
+                wax::stopwatch::cpu::thread cpu( trace, "cpu" );
+            } );
+        for ( auto &t : pool ) t.join();
+        { wax::stopwatch::monotonic last( trace, "last" ); }
+        trace.close();
+        dropped = trace.dropped();
+    }
+    CHECK( dropped == 0 );
+
+    const std::string json = slurp( path.c_str() );
+    if ( argc <= 1 ) ::unlink( path.c_str() );
+    CHECK( json.compare( 0, 39, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" ) == 0 );
+    CHECK( json.size() > 4 && json.compare( json.size() - 4, 4, "\n]}\n" ) == 0 );
+    CHECK( occurrences( json, "\"ph\":\"X\"" ) == (size_t) threads * spans * 2 + 1 );
+    CHECK( occurrences( json, "\"name\":\"request \\\"quoted\\\"\"" ) == (size_t) threads * spans );
+    CHECK( occurrences( json, "\"name\":\"parse\\\\path\"" ) == (size_t) threads * spans );
+    CHECK( occurrences( json, "\"args\":{\"depth\":1}" ) == (size_t) threads * spans );
+    CHECK( occurrences( json, "\"name\":\"cpu\"" ) == 0 );
+    CHECK( occurrences( json, "\"name\":\"last\"" ) == 1 );
+    return checks::failed();
+}
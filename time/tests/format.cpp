@@ -0,0 +1,86 @@
+//! @file format.cpp
+//  @brief Durations as text: the unit chosen, digits to the grain, rounding and signs.
+//
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+namespace {
+
+std::string text( int64_t ns, unsigned long grain ) {
+    char buf[ sw::format_size ];
+    return std::string( buf, sw::format( buf, ns, grain ) );
+}
+
+template< unsigned unit >
+std::string text_in( int64_t ns, unsigned long grain ) {
+    char buf[ sw::format_size ];
+    return std::string( buf, sw::format< unit >( buf, ns, grain ) );
+}
+
+}
+
+int main() {
+    // The unit follows the size, and a 1 ns grain keeps every digit.
+    CHECK( text( 0, 1 ) == "0 ns" );
+    CHECK( text( 999, 1 ) == "999 ns" );
+    CHECK( text( 1000, 1 ) == "1.000 μs" );
+    CHECK( text( 1234567, 1 ) == "1.234567 ms" );
+    CHECK( text( 2000000000, 1 ) == "2.000000000 s" );
+    CHECK( text( 61000000000, 1 ) == "61.000000000 s" );
+    CHECK( text( -1500, 1 ) == "-1.500 μs" );
+
+    // No digit finer than the largest power of ten within the grain, rounded half up.
+    CHECK( text( 1500, 10 ) == "1.50 μs" );
+    CHECK( text( 1505, 10 ) == "1.51 μs" );
+    CHECK( text( 1234567, 1000 ) == "1.235 ms" );
+    CHECK( text( 12345678, 4000000 ) == "12 ms" );
+    CHECK( text( 999999, 1000 ) == "1.000 ms" );
+    CHECK( text( 0, 0 ) == "0 ns" );
+
+    // A grain coarser than the value picks the unit, so the value reads as zero of it.
+    CHECK( text( 5, 1000000 ) == "0 ms" );
+    CHECK( text( 400000, 1000000 ) == "0 ms" );
+    CHECK( text( 600000, 1000000 ) == "1 ms" );
+
+    // A fixed unit keeps its digits to the grain too.
+    CHECK( text_in< sw::res::usec >( 1234567, 1 ) == "1234.567 μs" );
+    CHECK( text_in< sw::res::usec >( 1234567, 1000 ) == "1235 μs" );
+    CHECK( text_in< sw::res::msec >( 1234567, 1000 ) == "1.235 ms" );
+    CHECK( text_in< sw::res::sec >( 1500000, 1000000 ) == "0.002 s" );
+    CHECK( text_in< sw::res::nsec >( -42, 1 ) == "-42 ns" );
+
+    // The longest there is still fits.
+    char buf[ sw::format_size ];
+    CHECK( (size_t) ( sw::format( buf, INT64_MIN, 1 ) - buf ) <= sw::format_size );
+    CHECK( text( INT64_MIN, 1 ) == "-9223372036.854775808 s" );
+    CHECK( text( INT64_MAX, 1 ) == "9223372036.854775807 s" );
+
+    char pct[ sw::format_size ];
+    using wax::_impl::format::percent;
+    CHECK( std::string( pct, percent( pct, 825000 ) ) == "82.5 %" );
+    CHECK( std::string( pct, percent( pct, 1000000 ) ) == "100.0 %" );
+    CHECK( std::string( pct, percent( pct, -5000 ) ) == "-0.5 %" );
+
+    using wax::_impl::format::clock_name;
+    CHECK( ! strcmp( clock_name( CLOCK_MONOTONIC ), "monotonic" ) );
+    CHECK( ! strcmp( clock_name( CLOCK_THREAD_CPUTIME_ID ), "cpu::thread" ) );
+    CHECK( ! strcmp( clock_name( wax::_impl::clock::tsc ), "tsc" ) );
+    CHECK( ! strcmp( clock_name( 1234 ), "clock" ) );
+    CHECK( wax::_impl::format::grain( CLOCK_MONOTONIC ) >= 1 );
+    CHECK( wax::_impl::format::grain( 1234 ) == 1 );
+
+    // lap() rounds to the clock's grain, so a coarse clock shows only whole grains.
+    using wax::_impl::clock::coarse;
+    const int64_t g = (int64_t) wax::_impl::clock::resolution< coarse >();
+    CHECK( wax::_impl::clock::to_grain< coarse >( 0 ) == 0 );
+    CHECK( wax::_impl::clock::to_grain< coarse >( 5 * g + g / 2 - 1 ) % g == 0 );
+    sw::coarse c;
+    CHECK( (int64_t) c.lap() % g == 0 );
+
+    return checks::failed();
+}
@@ -0,0 +1,62 @@
+//! @file histogram.cpp
+//  @brief Histogram buckets and percentiles at their edges.
+//
+#include <stdint.h>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+using wax::stopwatch::histogram;
+
+int main() {
+    // Every value lands in a bucket that covers it, and buckets tile the range.
+    for ( int64_t v : { 0L, 1L, 255L, 256L, 257L, 511L, 512L, 1000L, 123456789L,
+                        (int64_t) histogram::max_trackable } ) {
+        const unsigned i = histogram::index( v );
+        CHECK( i < histogram::bucket_count );
+        CHECK( histogram::lowest( i ) <= v && v <= histogram::highest( i ) );
+    }
+    for ( unsigned i = 1; i < histogram::bucket_count; ++i )
+        CHECK( histogram::lowest( i ) == histogram::highest( i - 1 ) + 1 );
+    CHECK( histogram::index( 255 ) == 255 && histogram::index( 256 ) == 256 );
+    CHECK( histogram::index( -5 ) == 0 );
+    CHECK( histogram::index( INT64_MAX ) == histogram::bucket_count - 1 );
+
+    histogram h;
+    CHECK( h.count() == 0 );
+    CHECK( h.percentile( 50 ) == 0 && h.min() == 0 && h.max() == 0 );
+
+    h.record( 100 );
+    CHECK( h.p50() == 100 && h.p99() == 100 && h.p999() == 100 );
+    CHECK( h.percentile( 0 ) == 100 && h.percentile( 100 ) == 100 );
+    CHECK( h.percentile( -1 ) == 100 && h.percentile( 1000 ) == 100 );
+
+    // Below 256 ns every value is exact; the rank rounds to nearest.
+    h.clear();
+    for ( int64_t v = 1; v <= 100; ++v ) h.record( v );
+    CHECK( h.count() == 100 );
+    CHECK( h.min() == 1 && h.max() == 100 );
+    CHECK( h.p50() == 50 );
+    CHECK( h.p99() == 99 );
+    CHECK( h.percentile( 100 ) == 100 );
+    CHECK( h.percentile( 0.1 ) == 1 );
+
+    // Above, a percentile is the top of its bucket, never below the true value.
+    h.clear();
+    h.record( 1000000, 99 );
+    h.record( INT64_MAX );
+    CHECK( h.count() == 100 );
+    CHECK( h.p50() >= 1000000 && h.p50() <= 1000000 + 1000000 / 128 );
+    CHECK( h.max() == histogram::highest( histogram::bucket_count - 1 ) );
+    CHECK( h.percentile( 100 ) == h.max() );
+
+    histogram g;
+    g.record( 1 );
+    g.merge( h );
+    CHECK( g.count() == 101 && g.min() == 1 );
+
+    // A stopwatch built against it records its final lap there.
+    h.clear();
+    { wax::stopwatch::monotonic sw( h ); }
+    CHECK( h.count() == 1 );
+    return checks::failed();
+}
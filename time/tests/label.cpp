@@ -0,0 +1,47 @@
+//! @file label.cpp
+//  @brief Interning goes by the text, not the pointer it came from.
+//
+#include <string.h>
+#include <string>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace label = ::wax::_impl::label;
+
+int main() {
+    CHECK( label::intern( nullptr ) == label::none );
+    CHECK( label::name( label::none ) == nullptr );
+
+    const label::id_type alpha = label::intern( "alpha" );
+    CHECK( alpha != label::none );
+    CHECK( ::strcmp( label::name( alpha ), "alpha" ) == 0 );
+
+    // The same text from another buffer gets the same id.
+    const std::string copy( "alpha" );
+    CHECK( label::intern( copy.c_str() ) == alpha );
+
+    // A buffer reused for other text gets the other text's id.
+    char buf[ 16 ];
+    ::strcpy( buf, "beta" );
+    const label::id_type beta = label::intern( buf );
+    ::strcpy( buf, "gamma" );
+    const label::id_type gamma = label::intern( buf );
+    CHECK( beta != alpha );
+    CHECK( gamma != beta );
+    CHECK( ::strcmp( label::name( beta ), "beta" ) == 0 );
+    CHECK( ::strcmp( label::name( gamma ), "gamma" ) == 0 );
+    ::strcpy( buf, "beta" );
+    CHECK( label::intern( buf ) == beta );
+
+    // Ids are dense, and the name outlives the text it was interned from.
+    CHECK( label::last() >= gamma );
+    {
+        std::string *gone = new std::string( "delta, long enough to be on the heap" );
+        const label::id_type delta = label::intern( gone->c_str() );
+        delete gone;
+        CHECK( ::strcmp( label::name( delta ), "delta, long enough to be on the heap" ) == 0 );
+    }
+
+    CHECK( wax::stopwatch::label::of( "alpha" ).id == alpha );
+    return checks::failed();
+}
@@ -0,0 +1,109 @@
+//! @file metrics.cpp
+//  @brief OpenMetrics text for registered aggregates, unregistering, and a scrape over HTTP.
+//
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+namespace {
+
+std::string scrape() {
+    std::string out;
+    sw::openmetrics( out, "t" );
+    return out;
+}
+
+bool has( const std::string &text, const char *line ) {
+    return text.find( std::string( line ) + "\n" ) != std::string::npos;
+}
+
+//! @return Everything the server sends back for one request.
+std::string get( uint16_t port, const char *path ) {
+    const int c = ::socket( AF_INET, SOCK_STREAM, 0 );
+    struct sockaddr_in sa;
+    ::memset( &sa, 0, sizeof sa );
+    sa.sin_family      = AF_INET;
+    sa.sin_port        = htons( port );
+    sa.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    std::string reply;
+    if ( ::connect( c, (struct sockaddr *) &sa, sizeof sa ) == 0 ) {
+        const std::string req = std::string( "GET " ) + path + " HTTP/1.0\r\n\r\n";
+        (void) ! ::write( c, req.data(), req.size() );
+        char buf[ 4096 ];
+        for ( ssize_t n; ( n = ::read( c, buf, sizeof buf ) ) > 0; ) reply.append( buf, n );
+    }
+    ::close( c );
+    return reply;
+}
+
+}
+
+int main() {
+    CHECK( scrape() == "# EOF\n" );
+
+    {
+        sw::metric parse( WAX_STOPWATCH( "parse" ) );
+        parse.record( { "parse", 0, CLOCK_MONOTONIC, 0, 150 } );
+        parse.record( { "parse", 0, CLOCK_MONOTONIC, 0, 3000000 } );
+        CHECK( parse.distribution().count() == 2 && parse.totals().snapshot().count == 2 );
+
+        sw::accumulator only;
+        only.record( 2000000000 );
+        CHECK( sw::export_as( WAX_STOPWATCH( "only" ), only ) );
+
+        const std::string text = scrape();
+        CHECK( text.find( "# TYPE t_seconds histogram\n# UNIT t_seconds seconds\n" ) == 0 );
+        // Cumulative buckets, each taking values up to its bound.
+        CHECK( has( text, "t_seconds_bucket{label=\"parse\",le=\"1e-07\"} 0" ) );
+        CHECK( has( text, "t_seconds_bucket{label=\"parse\",le=\"2e-07\"} 1" ) );
+        CHECK( has( text, "t_seconds_bucket{label=\"parse\",le=\"0.002\"} 1" ) );
+        CHECK( has( text, "t_seconds_bucket{label=\"parse\",le=\"0.005\"} 2" ) );
+        CHECK( has( text, "t_seconds_bucket{label=\"parse\",le=\"+Inf\"} 2" ) );
+        CHECK( has( text, "t_seconds_count{label=\"parse\"} 2" ) );
+        CHECK( has( text, "t_seconds_sum{label=\"parse\"} 0.00300015" ) );
+        // An accumulator alone is a summary; every accumulator gives min and max.
+        CHECK( has( text, "# TYPE t_accumulated_seconds summary" ) );
+        CHECK( has( text, "t_accumulated_seconds_count{label=\"only\"} 1" ) );
+        CHECK( has( text, "t_accumulated_seconds_sum{label=\"only\"} 2" ) );
+        CHECK( has( text, "t_min_seconds{label=\"parse\"} 1.5e-07" ) );
+        CHECK( has( text, "t_max_seconds{label=\"only\"} 2" ) );
+        CHECK( text.size() > 6 && text.compare( text.size() - 6, 6, "# EOF\n" ) == 0 );
+
+        // A stopwatch records straight into a metric.
+        { sw::monotonic t( parse ); }
+        CHECK( parse.distribution().count() == 3 );
+
+        sw::unexport( only );
+        CHECK( scrape().find( "\"only\"" ) == std::string::npos );
+        CHECK( scrape().find( "\"parse\"" ) != std::string::npos );
+    }
+    // Gone with the metric, and nothing left to dereference.
+    CHECK( scrape() == "# EOF\n" );
+
+    // Labels are escaped.
+    sw::metric odd( WAX_STOPWATCH( "a \"b\"\\c" ) );
+    odd.record( { nullptr, 0, CLOCK_MONOTONIC, 0, 500 } );
+    CHECK( scrape().find( "{label=\"a \\\"b\\\"\\\\c\"," ) != std::string::npos );
+
+    // The exporter serves the same text, and 404 for anything else.
+    sw::exporter http( 0 );
+    CHECK( http.is_open() && http.port() != 0 );
+    if ( http.is_open() ) {
+        const std::string ok = get( http.port(), "/metrics" );
+        CHECK( ok.find( "HTTP/1.0 200 OK\r\n" ) == 0 );
+        CHECK( ok.find( "application/openmetrics-text" ) != std::string::npos );
+        CHECK( ok.find( "wax_stopwatch_seconds_count{label=\"a \\\"b\\\"\\\\c\"} 1\n" )
+               != std::string::npos );
+        CHECK( ok.size() > 6 && ok.compare( ok.size() - 6, 6, "# EOF\n" ) == 0 );
+        CHECK( get( http.port(), "/other" ).find( "HTTP/1.0 404" ) == 0 );
+    }
+
+    return checks::failed();
+}
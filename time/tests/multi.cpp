@@ -0,0 +1,114 @@
+//! @file multi.cpp
+//  @brief One region on several clocks: nesting, warm-up, and what derive() makes of it.
+//
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <thread>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+namespace {
+
+using sample = wax::_impl::stopwatch::sample;
+
+//! @brief A sink that keeps a copy of the last sample's readings.
+struct capture {
+    sw::reading  r[ 4 ] {};
+    uint32_t     n      { 0 };
+    int64_t      ns     { 0 };
+
+    void record( const sample &s ) {
+        n  = s.reading_count;
+        ns = s.ns;
+        for ( uint32_t i = 0; i < n && i < 4; ++i ) r[ i ] = s.readings[ i ];
+    }
+};
+
+void spin( int64_t ns ) {
+    sw::monotonic t;
+    while ( t.lap_ns() < ns ) {}
+}
+
+void sleep_ms( long ms ) {
+    struct timespec ts { 0, ms * 1000000L };
+    while ( ::nanosleep( &ts, &ts ) != 0 ) {}
+}
+
+}
+
+int main() {
+    capture c;
+
+    // The first multi in the process and on a new thread: tsc calibration and the task-clock
+    // page are set up before the first clock starts, not inside its interval.
+    std::thread( [ &c ] {
+        { sw::multi< sw::clock::monotonic, sw::clock::tsc, sw::clock::cpu::thread > m( c ); }
+    } ).join();
+    CHECK( c.n == 3 );
+    CHECK( c.r[ 0 ].ns < 2000000 );
+
+    // Starts in order and stops in reverse, so each interval encloses the next.
+    {
+        sw::multi< sw::clock::monotonic, sw::clock::monotonic_raw, sw::clock::tsc > m( c );
+        spin( 1000000 );
+    }
+    CHECK( c.n == 3 );
+    CHECK( c.r[ 0 ].clock == sw::clock::monotonic && c.r[ 1 ].clock == sw::clock::monotonic_raw );
+    CHECK( c.r[ 2 ].clock == sw::clock::tsc );
+    CHECK( c.ns == c.r[ 0 ].ns );
+    CHECK( c.r[ 0 ].ns >= 1000000 );
+    CHECK( c.r[ 0 ].ns + 1000 >= c.r[ 1 ].ns );
+    CHECK( c.r[ 1 ].ns + 100000 >= c.r[ 2 ].ns );
+
+    // Busy: nearly all on CPU.  Asleep: nearly all off.
+    sw::derived d;
+    {
+        sw::multi< sw::clock::monotonic, sw::clock::cpu::thread > m( c );
+        spin( 20000000 );
+        d = m.metrics();
+    }
+    CHECK( d.complete && d.wall_ns >= 20000000 );
+    CHECK( d.utilization > 0.5 && d.utilization <= 1.01 );
+    d = sw::derive( c.r, c.n );
+    CHECK( d.complete && d.off_cpu_ns == d.wall_ns - d.cpu_ns );
+    {
+        sw::multi< sw::clock::monotonic, sw::clock::cpu::thread > m( c );
+        sleep_ms( 20 );
+    }
+    d = sw::derive( c.r, c.n );
+    CHECK( d.complete && d.utilization < 0.5 );
+    CHECK( d.off_cpu_ns > 10000000 );
+
+    // One clock alone is a plain stopwatch with a single reading.
+    { sw::multi< sw::clock::monotonic > m( c ); }
+    CHECK( c.n == 1 );
+    d = sw::derive( c.r, c.n );
+    CHECK( ! d.complete );
+
+    // reset() restarts every clock.
+    {
+        sw::multi< sw::clock::monotonic, sw::clock::monotonic_raw > m( c );
+        spin( 2000000 );
+        m.reset();
+    }
+    CHECK( c.r[ 0 ].ns < 2000000 && c.r[ 1 ].ns < 2000000 );
+
+    // On a descriptor, a line per clock and the derived ones under the first.
+    FILE *f = ::tmpfile();
+    { sw::multi< sw::clock::monotonic, sw::clock::cpu::thread > m( ::fileno( f ), "handler" ); }
+    sw::flush();
+    ::rewind( f );
+    std::string text;
+    char line[ 256 ];
+    while ( ::fgets( line, sizeof line, f ) ) text += line;
+    ::fclose( f );
+    CHECK( text.find( "handler: " ) == 0 );
+    CHECK( text.find( "\n  cpu::thread: " ) != std::string::npos );
+    CHECK( text.find( "\n  off-cpu: " ) != std::string::npos );
+    CHECK( text.find( "\n  utilization: " ) != std::string::npos );
+
+    return checks::failed();
+}
@@ -0,0 +1,59 @@
+//! @file registry.cpp
+//  @brief Per-label count, sum and max in one arena, from many threads, with drops counted.
+//
+#include <stdint.h>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+int main() {
+    sw::registry r( 1024 );
+    CHECK( r.size() == 1024 );
+
+    const sw::label a = WAX_STOPWATCH( "registry.a" ), b = WAX_STOPWATCH( "registry.b" );
+    r.record( a, 100 );
+    r.record( a, 300 );
+    r.record( b, 50, 4 );
+    CHECK( r.count( a.id ) == 2 && r.sum( a.id ) == 400 && r.max( a.id ) == 300 );
+    CHECK( r.count( b.id ) == 4 && r.sum( b.id ) == 200 && r.max( b.id ) == 50 );
+    CHECK( r.count( 0 ) == 0 && r.dropped() == 0 );
+
+    // No slot for label::none or ids past capacity: only counted as dropped.
+    r.record( sw::label_id( 0 ), 10 );
+    r.record( sw::label_id( 1024 ), 10, 3 );
+    CHECK( r.dropped() == 4 );
+    CHECK( r.count( 1024 ) == 0 );
+
+    // A stopwatch with only a name has it interned.
+    { sw::monotonic t( r, "registry.named" ); }
+    const sw::label_id named = sw::label::of( "registry.named" ).id;
+    CHECK( named != 0 && r.count( named ) == 1 );
+
+    // From several threads at once nothing is lost, and the max is the largest seen.
+    static constexpr int threads = 4, each = 100000;
+    std::vector< std::thread > ts;
+    for ( int t = 0; t < threads; ++t )
+        ts.emplace_back( [ &r, a, t ] {
+            for ( int i = 0; i < each; ++i ) r.record( a, 1 + ( i == each / 2 ? t * 1000 : 0 ) );
+        } );
+    for ( auto &t : ts ) t.join();
+    CHECK( r.count( a.id ) == 2 + threads * each );
+    CHECK( r.sum( a.id ) == 400 + threads * each + 1000 * ( 0 + 1 + 2 + 3 ) );
+    CHECK( r.max( a.id ) == 3001 );
+
+    // Snapshots copy whole fields, and any may be skipped.
+    std::vector< uint64_t > counts( r.size() );
+    std::vector< int64_t >  maxes( r.size() );
+    r.snapshot( counts.data(), nullptr, maxes.data() );
+    CHECK( counts[ a.id ] == r.count( a.id ) && counts[ b.id ] == 4 );
+    CHECK( maxes[ a.id ] == 3001 && maxes[ b.id ] == 50 );
+
+    r.reset();
+    CHECK( r.count( a.id ) == 0 && r.sum( b.id ) == 0 && r.max( a.id ) == 0 );
+    CHECK( r.dropped() == 0 );
+
+    return checks::failed();
+}
@@ -0,0 +1,132 @@
+//! @file report.cpp
+//  @brief Lines for a descriptor come out whole and in order, and what is dropped is counted.
+//
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace {
+
+using watch = ::wax::_impl::stopwatch::base< wax::stopwatch::clock::monotonic >;
+
+//! @return Everything written to f so far.
+std::string contents( FILE *f ) {
+    std::string s;
+    ::rewind( f );
+    char buf[ 4096 ];
+    for ( size_t n; ( n = ::fread( buf, 1, sizeof buf, f ) ) > 0; ) s.append( buf, n );
+    return s;
+}
+
+std::vector< std::string > lines( const std::string &s ) {
+    std::vector< std::string > out;
+    for ( size_t at = 0, nl; ( nl = s.find( '\n', at ) ) != std::string::npos; at = nl + 1 )
+        out.push_back( s.substr( at, nl - at ) );
+    return out;
+}
+
+//! @brief A child that drops lines says so on standard error at exit.
+void exit_message() {
+    int err[ 2 ], out[ 2 ];
+    if ( ! CHECK( ::pipe( err ) == 0 && ::pipe( out ) == 0 ) ) return;
+    const pid_t child = ::fork();
+    if ( child == 0 ) {
+        ::dup2( err[ 1 ], 2 );
+        FILE *null = ::fopen( "/dev/null", "w" );
+        for ( int i = 0; i < 200000; ++i ) watch sw( ::fileno( null ), "flood" );
+        wax::stopwatch::flush();
+        const std::string n = std::to_string( wax::stopwatch::dropped() );
+        (void) ! ::write( out[ 1 ], n.data(), n.size() );
+        ::exit( 0 );
+    }
+    ::close( err[ 1 ] );
+    ::close( out[ 1 ] );
+    int status = 0;
+    ::waitpid( child, &status, 0 );
+    CHECK( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+    char buf[ 256 ] = {}, said[ 256 ] = {};
+    (void) ! ::read( out[ 0 ], buf, sizeof buf - 1 );
+    (void) ! ::read( err[ 0 ], said, sizeof said - 1 );
+    const std::string expect = std::string( buf ) + " report lines dropped";
+    if ( std::string( buf ) == "0" )
+        CHECK( said[ 0 ] == 0 );
+    else
+        CHECK( ::strstr( said, expect.c_str() ) != nullptr );
+    ::close( err[ 0 ] );
+    ::close( out[ 0 ] );
+}
+
+}
+
+int main() {
+    // First, while this process has no writer thread to fork.
+    exit_message();
+
+    FILE *f  = ::tmpfile();
+    int   fd = ::fileno( f );
+
+    // Fewer than a ring holds: every line, in order, from a label that is gone by then.
+    static constexpr int few = 1000;
+    for ( int i = 0; i < few; ++i ) {
+        const std::string label = "line " + std::to_string( i );
+        watch sw( fd, label.c_str() );
+    }
+    wax::stopwatch::flush();
+    std::vector< std::string > got = lines( contents( f ) );
+    CHECK( got.size() == few );
+    bool ordered = got.size() == few;
+    for ( int i = 0; ordered && i < few; ++i ) {
+        const std::string prefix = "line " + std::to_string( i ) + ": ";
+        ordered = got[ i ].compare( 0, prefix.size(), prefix ) == 0
+               && got[ i ].size() > prefix.size();
+    }
+    CHECK( ordered );
+    CHECK( wax::stopwatch::dropped() == 0 );
+
+    // Each thread's lines stay in that thread's order.
+    ::fclose( f );
+    f  = ::tmpfile();
+    fd = ::fileno( f );
+    std::vector< std::thread > pool;
+    for ( int t = 0; t < 3; ++t )
+        pool.emplace_back( [ fd, t ] {
+            for ( int i = 0; i < few; ++i ) {
+                const std::string label = "t" + std::to_string( t ) + " " + std::to_string( i );
+                watch sw( fd, label.c_str() );
+            }
+        } );
+    for ( auto &t : pool ) t.join();
+    wax::stopwatch::flush();
+    got = lines( contents( f ) );
+    int next[ 3 ] = {}, wrong = 0;
+    for ( const auto &l : got ) {
+        int t = -1, i = -1;
+        if ( ::sscanf( l.c_str(), "t%d %d:", &t, &i ) != 2 || t < 0 || t > 2 || i != next[ t ]++ )
+            ++wrong;
+    }
+    CHECK( got.size() == 3 * few );
+    CHECK( wrong == 0 );
+
+    // Far more than a ring holds, as fast as possible: every line is written or counted.
+    ::fclose( f );
+    f  = ::tmpfile();
+    fd = ::fileno( f );
+    static constexpr uint64_t many = 100000;
+    const uint64_t before = wax::stopwatch::dropped();
+    for ( uint64_t i = 0; i < many; ++i ) watch sw( fd, "many" );
+    wax::stopwatch::flush();
+    got = lines( contents( f ) );
+    CHECK( got.size() + ( wax::stopwatch::dropped() - before ) == many );
+    size_t whole = 0;
+    for ( const auto &l : got ) whole += l.compare( 0, 6, "many: " ) == 0;
+    CHECK( whole == got.size() );
+
+    ::fclose( f );
+    return checks::failed();
+}
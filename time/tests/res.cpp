@@ -0,0 +1,33 @@
+//! @file res.cpp
+//  @brief The unit suffix table, looked up at compile time and at run time.
+//
+#include <string.h>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace res = wax::stopwatch::res;
+
+// Settled by the compiler, so nothing is left to search at run time.
+static_assert( res::units< res::sec >()[ 0 ] == 's', "seconds" );
+static_assert( res::units< res::msec >()[ 0 ] == 'm', "milliseconds" );
+static_assert( res::units< res::nsec >()[ 0 ] == 'n', "nanoseconds" );
+static_assert( res::units( 7 )[ 0 ] == 0, "unknown resolutions have no suffix" );
+
+int main() {
+    CHECK( ! strcmp( res::units( res::sec ),  "s" ) );
+    CHECK( ! strcmp( res::units( res::msec ), "ms" ) );
+    CHECK( ! strcmp( res::units( res::usec ), "μs" ) );
+    CHECK( ! strcmp( res::units( res::nsec ), "ns" ) );
+    CHECK( ! strcmp( res::units( 10 ), "" ) );
+
+    // The table runs largest first, which format relies on to pick a unit.
+    const auto  &t = res::_impl::suffix_table;
+    const size_t n = sizeof t / sizeof t[ 0 ];
+    CHECK( n == 4 );
+    for ( size_t i = 1; i < n; ++i ) CHECK( t[ i - 1 ].first > t[ i ].first );
+
+    // Every caller shares the one table.
+    CHECK( res::units< res::usec >() == res::units( res::usec ) );
+
+    return checks::failed();
+}
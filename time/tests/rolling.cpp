@@ -0,0 +1,101 @@
+//! @file rolling.cpp
+//  @brief Records fall into the epoch they are made in, and windows see only fresh epochs.
+//
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+namespace {
+
+static constexpr int64_t epoch = 50000000;
+
+int64_t coarse_ns() {
+    return sw::clock::to_ns< sw::clock::coarse >( sw::clock::ticks< sw::clock::coarse >() );
+}
+
+//! @brief Wait until just after an epoch of length ns begins, so that a test step fits in it.
+void next_epoch( int64_t ns ) {
+    const int64_t e = coarse_ns() / ns;
+    while ( coarse_ns() / ns == e ) {
+        struct timespec ts { 0, 1000000 };
+        ::nanosleep( &ts, nullptr );
+    }
+}
+
+}
+
+int main() {
+    sw::rolling< sw::histogram, 3 > r( epoch );
+    CHECK( r.epoch_ns() == epoch && r.span_ns() == 3 * epoch );
+    CHECK( r.count( r.span_ns() ) == 0 && r.percentile( 50, r.span_ns() ) == 0 );
+
+    next_epoch( epoch );
+    r.record( 100, 10 );
+    CHECK( r.count( epoch ) == 10 );
+    CHECK( r.percentile( 50, epoch ) == 100 );
+
+    next_epoch( epoch );
+    for ( int i = 0; i < 5; ++i ) r.record( 1000 );
+    // The window is whole epochs, newest first, including the one in progress.
+    CHECK( r.count( epoch ) == 5 );
+    CHECK( r.count( 1 ) == 5 );
+    CHECK( r.count( 2 * epoch ) == 15 );
+    CHECK( r.count( epoch + 1 ) == 15 );
+    CHECK( r.percentile( 100, epoch ) >= 1000 );
+    CHECK( r.percentile( 50, 2 * epoch ) == 100 );
+    // Windows longer than the ring stop at the ring.
+    CHECK( r.count( 100 * epoch ) == 15 );
+
+    // Nobody records for a whole ring: everything goes stale, and the next record starts over.
+    for ( int i = 0; i < 4; ++i ) next_epoch( epoch );
+    CHECK( r.count( r.span_ns() ) == 0 );
+    r.record( 7 );
+    CHECK( r.count( r.span_ns() ) == 1 );
+
+    // A stopwatch records into it as a sink, weight and all.
+    { sw::monotonic t( r ); }
+    CHECK( r.count( epoch ) == 2 );
+
+    // Rings of accumulators give moments over the window.
+    sw::rolling< sw::accumulator, 2 > a( epoch );
+    next_epoch( epoch );
+    a.record( 10 );
+    a.record( 30 );
+    sw::moments m = a.snapshot( epoch );
+    CHECK( m.count == 2 && m.sum == 40 && m.min == 10 && m.max == 30 );
+    next_epoch( epoch );
+    a.record( 5 );
+    CHECK( a.snapshot( epoch ).count == 1 );
+    m = a.snapshot( a.span_ns() );
+    CHECK( m.count == 3 && m.min == 5 );
+    unsigned epochs = 0;
+    a.each( a.span_ns(), [ &epochs ]( const sw::accumulator & ) { ++epochs; } );
+    CHECK( epochs == 2 );
+
+    // Several threads recording through rotations lose nothing while the window holds it all.
+    static constexpr int64_t short_epoch = 20000000;
+    sw::rolling< sw::histogram, 16 > busy( short_epoch );
+    next_epoch( short_epoch );
+    std::atomic< bool >     stop { false };
+    std::atomic< uint64_t > made { 0 };
+    std::vector< std::thread > ts;
+    for ( int t = 0; t < 3; ++t )
+        ts.emplace_back( [ & ] {
+            uint64_t n = 0;
+            while ( ! stop.load( std::memory_order_relaxed ) ) { busy.record( 100 + n % 50 ); ++n; }
+            made.fetch_add( n );
+        } );
+    struct timespec ts_run { 0, 6 * short_epoch };
+    ::nanosleep( &ts_run, nullptr );
+    stop = true;
+    for ( auto &t : ts ) t.join();
+    CHECK( busy.count( busy.span_ns() ) == made.load() );
+
+    return checks::failed();
+}
@@ -0,0 +1,78 @@
+//! @file sampled.cpp
+//  @brief About one run in n is timed, each standing for n, so totals track the calls.
+//
+#include <stdint.h>
+#include <thread>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+namespace {
+
+using sample = wax::_impl::stopwatch::sample;
+
+//! @brief A sink that counts samples and their weights.
+struct tally {
+    uint64_t samples { 0 };
+    uint64_t weight  { 0 };
+    bool     uniform { true };
+
+    void record( const sample &s ) {
+        ++samples;
+        weight += s.weight;
+        uniform = uniform && s.weight == 64;
+    }
+};
+
+}
+
+int main() {
+    static constexpr uint64_t calls = 640000;
+
+    tally t;
+    uint64_t timed = 0;
+    for ( uint64_t i = 0; i < calls; ++i ) {
+        sw::sampled< 64 > s( t );
+        if ( s.timed() ) ++timed;
+        else CHECK( s.lap_ns() == 0 && s.name() == nullptr );
+    }
+    CHECK( t.samples == timed );
+    CHECK( t.uniform );
+    // The gaps average 64: within a few percent over ten thousand of them.
+    CHECK( t.samples > calls / 64 * 95 / 100 && t.samples < calls / 64 * 105 / 100 );
+    CHECK( t.weight == t.samples * 64 );
+
+    // Histograms and accumulators count a timed run 64 times.
+    sw::histogram   h;
+    sw::accumulator a;
+    uint64_t        n = 0;
+    for ( uint64_t i = 0; i < calls; ++i ) {
+        sw::sampled< 64 > s( h );
+        if ( s.timed() ) ++n;
+    }
+    CHECK( h.count() == n * 64 );
+    for ( uint64_t i = 0; i < calls; ++i ) { sw::sampled< 64 > s( a ); }
+    const sw::moments m = a.snapshot();
+    CHECK( m.count % 64 == 0 );
+    CHECK( m.count > calls * 95 / 100 && m.count < calls * 105 / 100 );
+
+    // One in one is every run, at weight 1.
+    sw::histogram every;
+    for ( int i = 0; i < 100; ++i ) {
+        sw::sampled< 1 > s( every, "every" );
+        CHECK( s.timed() );
+    }
+    CHECK( every.count() == 100 );
+
+    // Each thread keeps its own countdown.
+    tally per[ 2 ];
+    std::thread other( [ &per ] {
+        for ( uint64_t i = 0; i < calls; ++i ) { sw::sampled< 64 > s( per[ 1 ] ); }
+    } );
+    for ( uint64_t i = 0; i < calls; ++i ) { sw::sampled< 64 > s( per[ 0 ] ); }
+    other.join();
+    CHECK( per[ 0 ].samples > calls / 64 * 95 / 100 && per[ 1 ].samples > calls / 64 * 95 / 100 );
+
+    return checks::failed();
+}
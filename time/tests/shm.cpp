@@ -0,0 +1,120 @@
+//! @file shm.cpp
+//  @brief Shared segment slots are per label and clock, and readers never copy a torn one.
+//
+// The writer records 1 ns every time, so count, sum and the histogram agree in any consistent
+// copy.  It is also held mid-update by hand, to see the reader wait it out and then give up on
+// a writer that never finishes.
+//
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace shm = ::wax::_impl::shm;
+
+namespace {
+
+//! @brief Wall and CPU time under one label land in two slots, each saying its clock.
+void per_clock() {
+    const std::string name = "/wax.test_clocks." + std::to_string( ::getpid() );
+    wax::stopwatch::shared_segment out( name.c_str() );
+    wax::stopwatch::shared_view in( name.c_str() );
+    CHECK( out.is_open() && in.is_open() );
+    if ( ! out.is_open() || ! in.is_open() ) return;
+    for ( int i = 0; i < 3; ++i ) {
+        wax::stopwatch::real wall( out, "both" );
+        wax::stopwatch::cpu::proc cpu( out, "both" );
+    }
+    { wax::stopwatch::tsc cycles( out, "both" ); }
+    CHECK( in.size() == 3 );
+    bool real = false, proc = false, tsc = false;
+    wax::stopwatch::shared_totals t;
+    for ( uint32_t i = 0; i < in.size(); ++i ) {
+        if ( ! CHECK( in.read( i, t ) ) ) continue;
+        CHECK( ::strcmp( t.name, "both" ) == 0 );
+        real |= t.clock == CLOCK_REALTIME && t.stats.count == 3;
+        proc |= t.clock == CLOCK_PROCESS_CPUTIME_ID && t.stats.count == 3;
+        tsc  |= t.clock == wax::stopwatch::clock::tsc && t.stats.count == 1;
+    }
+    CHECK( real && proc && tsc );
+    CHECK( in.info().version == shm::version );
+}
+
+//! @brief No torn copies under a live writer, and a stuck writer is waited for, then not.
+void torn() {
+    const std::string name = "/wax.test_torn." + std::to_string( ::getpid() );
+    wax::stopwatch::shared_segment out( name.c_str() );
+    wax::stopwatch::shared_view in( name.c_str() );
+    CHECK( out.is_open() && in.is_open() );
+    if ( ! out.is_open() || ! in.is_open() ) return;
+
+    CHECK( in.live() );
+    const auto id = wax::stopwatch::label::of( "torn" ).id;
+    out.record( id, 1 );
+    wax::stopwatch::shared_totals t;
+    CHECK( in.size() == 1 && in.read( 0, t ) );
+    CHECK( ::strcmp( t.name, "torn" ) == 0 && t.clock == CLOCK_MONOTONIC );
+    CHECK( t.stats.count == 1 && t.stats.sum == 1 && t.stats.min == 1 && t.stats.max == 1 );
+    CHECK( t.percentile( 50 ) == 1 && t.percentile( 100 ) == 1 );
+    CHECK( ! in.read( 1, t ) );
+
+    std::atomic< bool > done { false };
+    std::thread writer( [ & ] {
+        while ( ! done.load( std::memory_order_relaxed ) ) out.record( id, 1, 3 );
+    } );
+    uint64_t good = 0, torn = 0;
+    for ( int i = 0; i < 20000; ++i )
+        if ( in.read( 0, t ) ) {
+            ++good;
+            uint64_t bucketed = 0;
+            for ( uint64_t b : t.buckets ) bucketed += b;
+            torn += (uint64_t) t.stats.sum != t.stats.count || bucketed != t.stats.count;
+        }
+    done = true;
+    writer.join();
+    CHECK( good > 0 );
+    CHECK( torn == 0 );
+
+    // Hold the slot's sequence number odd from a second mapping, as a writer mid-update does.
+    const int fd = ::shm_open( name.c_str(), O_RDWR, 0 );
+    CHECK( fd >= 0 );
+    if ( fd < 0 ) return;
+    const size_t size = shm::header_size + sizeof( shm::slot );
+    void *p = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    CHECK( p != MAP_FAILED );
+    if ( p == MAP_FAILED ) return;
+    char      *base = static_cast< char * >( p );
+    shm::slot &s    = *reinterpret_cast< shm::slot * >( base + shm::header_size );
+    const uint32_t seq = s.seq.load();
+    CHECK( ( seq & 1 ) == 0 );
+
+    s.seq.store( seq + 1 );
+    std::thread finish( [ & ] {
+        ::usleep( 1000 );
+        s.seq.store( seq + 2 );
+    } );
+    CHECK( in.read( 0, t ) );
+    finish.join();
+    CHECK( (uint64_t) t.stats.sum == t.stats.count );
+
+    // A writer that never finishes: the reader gives up rather than spin forever.
+    s.seq.store( seq + 3 );
+    CHECK( ! in.read( 0, t ) );
+    s.seq.store( seq + 4 );
+    CHECK( in.read( 0, t ) );
+    ::munmap( p, size );
+}
+
+}
+
+int main() {
+    per_clock();
+    torn();
+    return checks::failed();
+}
@@ -0,0 +1,108 @@
+//! @file slow.cpp
+//  @brief Only timings over budget are reported, with the thread and context; adaptive budgets
+//  follow the tail.
+//
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+namespace {
+
+using sample = wax::_impl::stopwatch::sample;
+
+//! @brief A sink that keeps the counters of the last sample.
+struct capture {
+    unsigned  count     { 0 };
+    int64_t   ns        { 0 };
+    uint32_t  counters  { 0 };
+    uint64_t  thread    { 0 };
+    uint64_t  context   { 0 };
+
+    void record( const sample &s ) {
+        ++count;
+        ns       = s.ns;
+        counters = s.counter_count;
+        for ( uint32_t i = 0; i < s.counter_count; ++i ) {
+            if ( ! strcmp( s.counters[ i ].name, "thread" ) )  thread  = s.counters[ i ].value;
+            if ( ! strcmp( s.counters[ i ].name, "context" ) ) context = s.counters[ i ].value;
+        }
+    }
+};
+
+void spin( int64_t ns ) {
+    sw::monotonic t;
+    while ( t.lap_ns() < ns ) {}
+}
+
+}
+
+int main() {
+    capture c;
+
+    // A budget fixed at compile time.
+    { sw::slow< 5000000 > s( c, "fast" ); }
+    CHECK( c.count == 0 );
+    {
+        sw::slow< 1000000 > s( c, "slow" );
+        s.context( 42 );
+        spin( 1000000 );
+    }
+    CHECK( c.count == 1 && c.ns >= 1000000 );
+    CHECK( c.counters == 2 && c.context == 42 );
+    CHECK( c.thread == wax::_impl::thread::id() );
+    { sw::slow< 1000 > s( c ); spin( 2000 ); }
+    CHECK( c.count == 2 && c.counters == 1 );
+
+    // A threshold object, changed at run time.
+    sw::threshold budget( 1000000 );
+    CHECK( ! budget.exceeded( 999999 ) && budget.exceeded( 1000000 ) );
+    { sw::slow<> s( budget, c ); }
+    CHECK( c.count == 2 );
+    budget.set( 1000 );
+    CHECK( budget.budget_ns() == 1000 );
+    { sw::slow<> s( budget, c ); spin( 2000 ); }
+    CHECK( c.count == 3 );
+
+    // Adaptive: after a while it sits at the window's 99th percentile, whatever the floor.
+    sw::threshold tail( 1000, sw::threshold::adaptive, 99.0 );
+    sw::monotonic t;
+    uint64_t over = 0, seen = 0;
+    while ( t.lap_ns() < 400000000 ) {
+        const bool settled = t.lap_ns() > 250000000;
+        for ( int64_t i = 0; i < 1000; ++i ) {
+            const bool x = tail.exceeded( i * 1000 );
+            if ( settled ) { over += x; ++seen; }
+        }
+    }
+    CHECK( tail.budget_ns() >= 980000 && tail.budget_ns() <= 1000000 + 1000000 / 64 );
+    CHECK( seen > 0 && over <= seen / 50 );
+
+    // And never drops below the floor.
+    sw::threshold floor( 5000000, sw::threshold::adaptive, 50.0 );
+    t.reset();
+    while ( t.lap_ns() < 200000000 ) floor.exceeded( 1000 );
+    CHECK( floor.budget_ns() == 5000000 );
+
+    // On a descriptor, indented lines for the thread and context under the time.
+    FILE *f = ::tmpfile();
+    {
+        sw::slow< 1000 > s( ::fileno( f ), "late" );
+        s.context( 7 );
+        spin( 2000 );
+    }
+    sw::flush();
+    ::rewind( f );
+    std::string text;
+    char line[ 256 ];
+    while ( ::fgets( line, sizeof line, f ) ) text += line;
+    ::fclose( f );
+    CHECK( text.find( "late: " ) == 0 );
+    CHECK( text.find( "\n  thread: " ) != std::string::npos );
+    CHECK( text.find( "\n  context: 7\n" ) != std::string::npos );
+
+    return checks::failed();
+}
@@ -0,0 +1,92 @@
+//! @file span.cpp
+//  @brief Spans nest into a call tree, and a full tree sends the rest to "<overflow>".
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace {
+
+struct totals {
+    uint64_t count  { 0 };
+    int64_t  total  { 0 };
+    int64_t  self   { 0 };
+};
+
+//! @return What report() writes for spans on this clock, by path.
+template< typename span_type >
+std::map< std::string, totals > report() {
+    FILE *f = ::tmpfile();
+    span_type::report( ::fileno( f ) );
+    ::rewind( f );
+    std::map< std::string, totals > out;
+    char path[ 256 ];
+    totals t;
+    while ( ::fscanf( f, "%255s %lu %ld %ld", path, &t.count, &t.total, &t.self ) == 4 )
+        out[ path ] = t;
+    ::fclose( f );
+    return out;
+}
+
+}
+
+int main() {
+    using wax::stopwatch::span;
+    {
+        span outer( "outer" );
+        CHECK( outer.depth() == 0 );
+        CHECK( outer.parent_id() == 0 );
+        for ( int i = 0; i < 3; ++i ) {
+            span inner( "inner" );
+            CHECK( inner.depth() == 1 );
+            CHECK( inner.parent_id() == outer.id() );
+            { span leaf( "leaf" ); CHECK( leaf.depth() == 2 ); }
+        }
+        span other( "other" );
+        CHECK( other.parent_id() == outer.id() );
+    }
+    auto tree = report< span >();
+    CHECK( tree.size() == 4 );
+    CHECK( tree[ "outer" ].count == 1 );
+    CHECK( tree[ "outer;inner" ].count == 3 );
+    CHECK( tree[ "outer;inner;leaf" ].count == 3 );
+    CHECK( tree[ "outer;other" ].count == 1 );
+    CHECK( tree[ "outer" ].total - tree[ "outer" ].self
+           == tree[ "outer;inner" ].total + tree[ "outer;other" ].total );
+    CHECK( tree[ "outer;inner" ].total - tree[ "outer;inner" ].self
+           == tree[ "outer;inner;leaf" ].total );
+
+    // Fill a tree of its own, spans nested inside the overflow included.
+    using raw = wax::stopwatch::span_on< wax::stopwatch::clock::monotonic_raw >;
+    // Every node but the root, top and the overflow node itself.
+    static constexpr uint32_t room = wax::_impl::stopwatch::span_tree::max_nodes - 3;
+    static constexpr int      runs = room + 100;
+    {
+        raw top( "top" );
+        for ( int i = 0; i < runs; ++i ) {
+            const std::string name = "s" + std::to_string( i );
+            raw s( name.c_str() );
+            if ( i >= (int) room ) {
+                CHECK( s.id() == wax::_impl::stopwatch::span_tree::overflow );
+                raw nested( ( name + ".nested" ).c_str() );
+                CHECK( nested.id() == s.id() );
+            }
+        }
+    }
+    auto full = report< raw >();
+    CHECK( full.size() == room + 2 );
+    CHECK( full.count( "<overflow>" ) == 1 );
+    const totals over = full[ "<overflow>" ];
+    CHECK( over.count == 2 * ( runs - room ) );
+    // Nested overflow counts once in total, and self still adds up.
+    CHECK( over.total == over.self );
+    int64_t children = 0;
+    for ( const auto &p : full )
+        if ( p.first != "top" ) children += p.second.total;
+    CHECK( full[ "top" ].total - full[ "top" ].self == children );
+    return checks::failed();
+}
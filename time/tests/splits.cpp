@@ -0,0 +1,99 @@
+//! @file splits.cpp
+//  @brief Splits become intervals that add up to the total, within capacity.
+//
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+namespace {
+
+using sample = wax::_impl::stopwatch::sample;
+using split  = wax::_impl::stopwatch::split;
+
+//! @brief A sink that keeps the last sample and a copy of its splits.
+struct capture {
+    sample                 last  {};
+    std::vector< split >   parts;
+    unsigned               count { 0 };
+
+    void record( const sample &s ) {
+        last = s;
+        parts.assign( s.splits, s.splits + s.split_count );
+        last.splits = nullptr;
+        ++count;
+    }
+};
+
+void spin( int64_t ns ) {
+    sw::monotonic t;
+    while ( t.lap_ns() < ns ) {}
+}
+
+std::string drained( FILE *f ) {
+    sw::flush();
+    ::rewind( f );
+    std::string out;
+    char line[ 256 ];
+    while ( ::fgets( line, sizeof line, f ) ) out += line;
+    return out;
+}
+
+}
+
+int main() {
+    const sw::label parse = WAX_STOPWATCH( "parse" ), plan = WAX_STOPWATCH( "plan" ),
+                    run   = WAX_STOPWATCH( "run" );
+    capture c;
+    {
+        sw::splits< 4 > s( c, WAX_STOPWATCH( "request" ) );
+        spin( 100000 ); s.split( parse );
+        spin( 200000 ); s.split( plan );
+        spin( 300000 ); s.split( run );
+        CHECK( s.size() == 3 );
+    }
+    CHECK( c.count == 1 );
+    CHECK( c.last.id == WAX_STOPWATCH( "request" ).id );
+    CHECK( c.parts.size() == 3 );
+    if ( c.parts.size() == 3 ) {
+        CHECK( c.parts[ 0 ].id == parse.id && c.parts[ 1 ].id == plan.id );
+        CHECK( c.parts[ 2 ].id == run.id );
+        CHECK( c.parts[ 0 ].ns >= 100000 && c.parts[ 1 ].ns >= 200000 );
+        CHECK( c.parts[ 2 ].ns >= 300000 );
+        // Intervals, not readings: together they fit in the total.
+        const int64_t sum = c.parts[ 0 ].ns + c.parts[ 1 ].ns + c.parts[ 2 ].ns;
+        CHECK( sum <= c.last.ns && sum >= 600000 );
+    }
+
+    // Past capacity splits are ignored; reset() forgets the ones taken.
+    {
+        sw::splits< 2 > s( c );
+        s.split( parse ); s.split( plan ); s.split( run );
+        CHECK( s.size() == 2 );
+        s.reset();
+        CHECK( s.size() == 0 );
+        s.split( run );
+    }
+    CHECK( c.count == 2 );
+    CHECK( c.parts.size() == 1 && c.parts[ 0 ].id == run.id );
+
+    // On a descriptor, one indented line per split under the total.
+    FILE *f = ::tmpfile();
+    {
+        sw::splits< 4 > s( ::fileno( f ), WAX_STOPWATCH( "request" ) );
+        s.split( parse );
+        s.split( plan );
+    }
+    const std::string text = drained( f );
+    CHECK( text.find( "request: " ) == 0 );
+    CHECK( text.find( "\n  parse: " ) != std::string::npos );
+    CHECK( text.find( "\n  plan: " ) > text.find( "\n  parse: " ) );
+    ::fclose( f );
+
+    return checks::failed();
+}
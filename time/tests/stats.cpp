@@ -0,0 +1,73 @@
+//! @file stats.cpp
+//  @brief Bulk statistics agree with each other and with the data, on arrays and on a trace.
+//
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace stats = wax::stopwatch::stats;
+
+int main() {
+    std::vector< int64_t > v;
+    for ( int64_t i = 1000; i >= 1; --i ) v.push_back( i * 1000 );
+
+    // quantile() is exact, by histogram::percentile()'s rank.
+    CHECK( stats::quantile( v.data(), 0, 50 ) == 0 );
+    CHECK( stats::quantile( v.data(), v.size(), 50 ) == 500000 );
+    CHECK( stats::quantile( v.data(), v.size(), 0 ) == 1000 );
+    CHECK( stats::quantile( v.data(), v.size(), 100 ) == 1000000 );
+    CHECK( stats::quantile( v.data(), v.size(), 99.9 ) == 999000 );
+
+    wax::stopwatch::moments m = stats::summarize( v.data(), v.size() );
+    CHECK( m.count == 1000 && m.min == 1000 && m.max == 1000000 );
+    CHECK( m.sum == 1000 * 1001 / 2 * 1000 );
+    m = stats::summarize( v.data(), 0 );
+    CHECK( m.count == 0 );
+
+    // Enough values for several threads, which must agree with one.
+    std::vector< int64_t > big( 300000 );
+    for ( size_t i = 0; i < big.size(); ++i ) big[ i ] = (int64_t) ( i * 7919 % 100003 );
+    const wax::stopwatch::moments one  = stats::summarize( big.data(), big.size(), 1 );
+    const wax::stopwatch::moments four = stats::summarize( big.data(), big.size(), 4 );
+    CHECK( one.count == four.count && one.sum == four.sum );
+    CHECK( one.min == four.min && one.max == four.max );
+    std::vector< int64_t > sorted( big );
+    std::sort( sorted.begin(), sorted.end() );
+    for ( double pct : { 1.0, 50.0, 99.0 } ) {
+        const size_t rank = (size_t) ( pct / 100.0 * big.size() + 0.5 );
+        CHECK( stats::quantile( big.data(), big.size(), pct, 4 ) == sorted[ rank - 1 ] );
+    }
+    wax::stopwatch::histogram h1, h4;
+    stats::bucket( big.data(), big.size(), h1, 1 );
+    stats::bucket( big.data(), big.size(), h4, 4 );
+    CHECK( h1.count() == big.size() && h4.count() == big.size() );
+    CHECK( h1.p50() == h4.p50() && h1.p99() == h4.p99() );
+
+    // Over a trace, entries of other labels are left out when one is asked for.
+    const std::string path = "/tmp/wax_test_stats." + std::to_string( ::getpid() );
+    {
+        wax::stopwatch::trace_file out( path.c_str(), 1024 );
+        wax::stopwatch::trace_view in( path.c_str() );
+        ::unlink( path.c_str() );
+        CHECK( out.is_open() && in.is_open() );
+        const auto a = wax::stopwatch::label::of( "a" ).id;
+        const auto b = wax::stopwatch::label::of( "b" ).id;
+        for ( int64_t i = 1; i <= 100; ++i ) {
+            out.record( wax::_impl::stopwatch::sample { nullptr, a, CLOCK_MONOTONIC, 0, i } );
+            out.record( wax::_impl::stopwatch::sample { nullptr, b, CLOCK_MONOTONIC, 0, 1000 } );
+        }
+        CHECK( stats::summarize( in ).count == 200 );
+        const wax::stopwatch::moments ma = stats::summarize( in, a );
+        CHECK( ma.count == 100 && ma.min == 1 && ma.max == 100 && ma.sum == 5050 );
+        CHECK( stats::quantile( in, 50, a ) == 50 );
+        CHECK( stats::quantile( in, 50, b ) == 1000 );
+        CHECK( stats::quantile( in, 100 ) == 1000 );
+        wax::stopwatch::histogram h;
+        stats::bucket( in, h, b );
+        CHECK( h.count() == 100 );
+    }
+    return checks::failed();
+}
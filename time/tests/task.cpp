@@ -0,0 +1,102 @@
+//! @file task.cpp
+//  @brief A task timed across threads: active, suspended, CPU time and resumes add up.
+//
+#include <stdint.h>
+#include <time.h>
+#include <thread>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace sw = wax::stopwatch;
+
+namespace {
+
+using sample = wax::_impl::stopwatch::sample;
+
+//! @brief A sink that keeps the figures of the last sample.
+struct capture {
+    unsigned  count      { 0 };
+    int64_t   total      { 0 };
+    int64_t   active     { 0 };
+    int64_t   suspended  { 0 };
+    int64_t   wall       { 0 };
+    int64_t   cpu        { 0 };
+    uint64_t  resumes    { 0 };
+
+    void record( const sample &s ) {
+        ++count;
+        total = s.ns;
+        if ( s.split_count == 2 ) {
+            active    = s.splits[ 0 ].ns;
+            suspended = s.splits[ 1 ].ns;
+        }
+        if ( s.reading_count == 2 ) {
+            wall = s.readings[ 0 ].ns;
+            cpu  = s.readings[ 1 ].ns;
+        }
+        if ( s.counter_count == 1 ) resumes = s.counters[ 0 ].value;
+    }
+};
+
+void spin( int64_t ns ) {
+    sw::cpu::thread t;
+    while ( t.lap_ns() < ns ) {}
+}
+
+void sleep_ms( long ms ) {
+    struct timespec ts { 0, ms * 1000000L };
+    while ( ::nanosleep( &ts, &ts ) != 0 ) {}
+}
+
+}
+
+int main() {
+    capture c;
+    {
+        sw::task t( c, "request" );
+        // Three stretches on three threads, each burning 5 ms of its own CPU time, with the
+        // task suspended while the main thread sleeps in between.
+        for ( int i = 0; i < 3; ++i ) {
+            std::thread( [ &t ] {
+                sw::resumed< sw::task > run( t );
+                spin( 5000000 );
+            } ).join();
+            sleep_ms( 10 );
+        }
+        CHECK( t.resumes() == 3 );
+        CHECK( t.cpu_ns() >= 15000000 );
+        CHECK( t.active_ns() >= t.cpu_ns() - 1000000 );
+
+        // Resuming twice, or suspending while suspended, changes nothing.
+        t.resume();
+        t.resume();
+        t.suspend();
+        t.suspend();
+        CHECK( t.resumes() == 4 );
+    }
+    CHECK( c.count == 1 );
+    CHECK( c.resumes == 4 );
+    CHECK( c.cpu >= 15000000 && c.cpu < 100000000 );
+    CHECK( c.active == c.wall );
+    CHECK( c.active + c.suspended == c.total );
+    CHECK( c.suspended >= 30000000 );
+    // The CPU time is the threads' own, however they came and went.
+    CHECK( c.active >= c.cpu - 1000000 );
+
+    // complete() reports once; the destructor then does nothing.
+    {
+        sw::task t( c );
+        t.resume();
+        t.complete();
+        CHECK( c.count == 2 && c.resumes == 1 );
+        t.resume();
+    }
+    CHECK( c.count == 2 );
+
+    // Never resumed: all of it suspended.
+    { sw::task t( c ); sleep_ms( 2 ); }
+    CHECK( c.count == 3 && c.resumes == 0 );
+    CHECK( c.active == 0 && c.cpu == 0 && c.suspended == c.total );
+
+    return checks::failed();
+}
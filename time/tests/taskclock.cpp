@@ -0,0 +1,86 @@
+//! @file taskclock.cpp
+//  @brief Thread CPU time from the perf page agrees with CLOCK_THREAD_CPUTIME_ID, and falls back
+//  to it when the page can't be read.
+//
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <thread>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace tc = wax::_impl::taskclock;
+
+namespace {
+
+int64_t gap( int64_t a, int64_t b ) { return a > b ? a - b : b - a; }
+
+void spin( int64_t ns ) {
+    const int64_t end = tc::syscall_ns() + ns;
+    while ( tc::syscall_ns() < end ) {}
+}
+
+//! @return Failed checks in the calling thread: readings on either path track the system call.
+int agrees() {
+    const int before = checks::failures();
+    const int64_t a0 = tc::now(), s0 = tc::syscall_ns();
+    CHECK( gap( a0, s0 ) < 1000000 );
+    spin( 10000000 );
+    const int64_t a1 = tc::now(), s1 = tc::syscall_ns();
+    CHECK( a1 >= a0 + 9000000 );
+    CHECK( gap( a1 - a0, s1 - s0 ) < 1000000 );
+    int64_t last = tc::now();
+    bool    monotone = true;
+    for ( int i = 0; i < 100000; ++i ) {
+        const int64_t n = tc::now();
+        monotone = monotone && n >= last;
+        last = n;
+    }
+    CHECK( monotone );
+    return checks::failures() - before;
+}
+
+}
+
+int main() {
+    const bool direct = tc::direct();
+    fprintf( stderr, "taskclock: %s\n", direct ? "perf page" : "clock_gettime() fallback" );
+    CHECK( tc::direct() == direct );
+    agrees();
+
+    // A page without user-readable time is refused, which is what sends a thread to the system
+    // call for good.
+    struct perf_event_mmap_page fake;
+    ::memset( &fake, 0, sizeof fake );
+    int64_t ns = 12345;
+    CHECK( ! tc::_impl::read_page( &fake, ns ) );
+
+    // Every thread has its own clock, starting from its own CPU time rather than this one's.
+    int64_t other = -1;
+    int     failed_there = 0;
+    std::thread( [ & ] {
+        other = tc::now();
+        failed_there = agrees();
+    } ).join();
+    CHECK( other >= 0 && other < tc::now() );
+    CHECK( failed_there == 0 );
+
+    // A forked child reopens rather than reading the parent's page.
+    const pid_t child = ::fork();
+    if ( child == 0 ) ::_exit( agrees() ? 1 : 0 );
+    int status = 0;
+    CHECK( ::waitpid( child, &status, 0 ) == child );
+    CHECK( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+
+    // Through the clock tables and the cpu::thread stopwatch.
+    using wax::stopwatch::clock::cpu::thread;
+    CHECK( gap( wax::_impl::clock::now< thread >(), tc::syscall_ns() ) < 1000000 );
+    wax::stopwatch::cpu::thread sw;
+    spin( 2000000 );
+    CHECK( sw.lap_ns() >= 1900000 );
+
+    return checks::failed();
+}
@@ -0,0 +1,81 @@
+//! @file trace.cpp
+//  @brief Trace readers see each complete entry once, and never a half-written or lapped one.
+//
+// The writer keeps every entry self-consistent, start and ns both equal to its index, so a copy
+// mixing two writes shows.
+//
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace trace = ::wax::_impl::trace;
+
+int main() {
+    const std::string path = "/tmp/wax_test_trace." + std::to_string( ::getpid() );
+    wax::stopwatch::trace_file out( path.c_str(), 64 );
+    wax::stopwatch::trace_view in( path.c_str() );
+    const int fd = ::open( path.c_str(), O_RDWR );
+    ::unlink( path.c_str() );
+    CHECK( out.is_open() && in.is_open() && fd >= 0 );
+    if ( ! out.is_open() || ! in.is_open() || fd < 0 ) return checks::failed();
+
+    const auto id = wax::stopwatch::label::of( "traced" ).id;
+    auto write = [ & ]( int64_t v ) {
+        out.record( wax::_impl::stopwatch::sample { nullptr, id, CLOCK_MONOTONIC, v, v } );
+    };
+
+    write( 0 );
+    trace::event e;
+    CHECK( in.first() == 0 && in.end() == 1 );
+    CHECK( in.read( 0, e ) && e.start == 0 && e.ns == 0 && e.label == id );
+    CHECK( e.clock == CLOCK_MONOTONIC );
+    CHECK( ! in.read( 1, e ) );
+    bool named = false;
+    in.each_label( [ & ]( uint32_t i, const char *name, uint32_t len ) {
+        named |= i == id && std::string( name, len ) == "traced"; } );
+    CHECK( named );
+
+    // An entry whose writer is part way through is skipped.
+    const size_t size = trace::header_size + trace::labels_size + 64 * sizeof( trace::entry );
+    void *p = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    CHECK( p != MAP_FAILED );
+    if ( p != MAP_FAILED ) {
+        char *base  = static_cast< char * >( p );
+        auto *slots = reinterpret_cast< trace::entry * >( base + in.info().entries_offset );
+        slots[ 0 ].seq.store( 0 );
+        CHECK( ! in.read( 0, e ) );
+        slots[ 0 ].seq.store( 1 );
+        CHECK( in.read( 0, e ) );
+        ::munmap( p, size );
+    }
+
+    // Lapped: an entry overwritten by a later one is gone, not mistaken for it.
+    for ( int64_t i = 1; i < 65; ++i ) write( i );
+    CHECK( ! in.read( 0, e ) );
+    CHECK( in.read( 64, e ) && e.start == 64 && e.ns == 64 );
+    CHECK( in.first() == 1 && in.end() == 65 );
+
+    std::atomic< bool > done { false };
+    std::thread writer( [ & ] {
+        for ( int64_t v = 65; ! done.load( std::memory_order_relaxed ); ++v ) write( v );
+    } );
+    uint64_t good = 0, torn = 0;
+    for ( int pass = 0; pass < 2000; ++pass )
+        for ( uint64_t i = in.first(), end = in.end(); i < end; ++i )
+            if ( in.read( i, e ) ) {
+                ++good;
+                torn += e.start != e.ns || e.start != (int64_t) i;
+            }
+    done = true;
+    writer.join();
+    CHECK( good > 0 );
+    CHECK( torn == 0 );
+    return checks::failed();
+}
@@ -0,0 +1,72 @@
+//! @file tsc.cpp
+//  @brief The cycle-counter clock against CLOCK_MONOTONIC_RAW, calibrated or not.
+//
+#include <stdint.h>
+#include <time.h>
+#include "check.hpp"
+#include "../stopwatch.hpp"
+
+namespace tsc = wax::_impl::tsc;
+
+namespace {
+
+int64_t raw() {
+    struct timespec ts;
+    ::clock_gettime( CLOCK_MONOTONIC_RAW, &ts );
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void sleep_ms( long ms ) {
+    struct timespec ts { 0, ms * 1000000L };
+    while ( ::nanosleep( &ts, &ts ) != 0 ) {}
+}
+
+int64_t gap( int64_t a, int64_t b ) { return a > b ? a - b : b - a; }
+
+}
+
+int main() {
+    const tsc::calibration &c = tsc::calibrated();
+    CHECK( &c == &tsc::calibrated() );
+    CHECK( c.mult != 0 );
+    if ( ! c.usable ) {
+        // The fallback is CLOCK_MONOTONIC_RAW itself, with the identity conversion.
+        CHECK( c.mult == 1UL << c.shift );
+        CHECK( tsc::elapsed_ns( 12345 ) == 12345 );
+        CHECK( gap( tsc::ticks(), raw() ) < 1000000 );
+    }
+
+    // now() sits on the CLOCK_MONOTONIC_RAW timeline, and stays there.
+    CHECK( gap( tsc::now(), raw() ) < 1000000 );
+    const int64_t t0 = tsc::ticks(), r0 = raw();
+    sleep_ms( 50 );
+    const int64_t t1 = tsc::ticks(), r1 = raw();
+    CHECK( gap( tsc::elapsed_ns( t1 - t0 ), r1 - r0 ) < ( r1 - r0 ) / 100 + 100000 );
+    CHECK( gap( tsc::timestamp( t1 ), r1 ) < 1000000 );
+    CHECK( gap( tsc::now(), raw() ) < 1000000 );
+
+    // Back-to-back readings never go backwards.
+    int64_t last = tsc::now();
+    bool    monotone = true;
+    for ( int i = 0; i < 100000; ++i ) {
+        const int64_t n = tsc::now();
+        monotone = monotone && n >= last;
+        last = n;
+    }
+    CHECK( monotone );
+
+    struct timespec ts;
+    CHECK( tsc::gettime( &ts ) == 0 );
+    CHECK( ts.tv_nsec >= 0 && ts.tv_nsec < 1000000000L );
+    CHECK( tsc::getres( &ts ) == 0 );
+    if ( c.usable ) CHECK( ts.tv_sec == 0 && ts.tv_nsec == 1 );
+
+    // Through a stopwatch, as the clock tables see it.
+    wax::stopwatch::tsc sw;
+    sleep_ms( 20 );
+    const int64_t lap = sw.lap_ns();
+    CHECK( lap >= 19000000 && lap < 1000000000 );
+    CHECK( wax::_impl::clock::resolution< wax::_impl::clock::tsc >() >= 1 );
+
+    return checks::failed();
+}
@@ -0,0 +1,188 @@
+//! @file sw_bench.cpp
+//  @brief What the stopwatches cost: clock reads, construction, and each sink under contention.
+//
+//  sw_bench [ --threads=n ] [ wax::bench options ]
+//
+//  lap_ns/<clock> and reset/<clock> are one read of each clock through a stopwatch.
+//  construct/<args> is a monotonic stopwatch made and destroyed with those arguments.
+//  sink/<sink>/threads:<t> is a stopwatch recording into a shared sink from t threads at once,
+//  t doubling up to --threads, by default the number of CPUs; its time is per recording over
+//  all threads.  The JSON report goes to standard output.
+//
+//  Report lines are queued for a background writer and dropped when a thread's queue is full, so
+//  construct/fd_label and sink/fd give the fraction of their recordings that were dropped as the
+//  counter "dropped": their times are those of a mix of queued and dropped lines.
+//
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../bench.hpp"
+#include "../stopwatch.hpp"
+
+namespace {
+
+using namespace ::wax::_impl;
+
+template< clock::_hw_type clock_type >
+using watch = ::wax::_impl::stopwatch::base< clock_type >;
+
+template< clock::_hw_type clock_type >
+void lap_ns( wax::bench::state &st ) {
+    watch< clock_type > sw;
+    for ( auto _ : st ) wax::bench::do_not_optimize( sw.lap_ns() );
+}
+
+template< clock::_hw_type clock_type >
+void reset( wax::bench::state &st ) {
+    watch< clock_type > sw;
+    for ( auto _ : st ) {
+        sw.reset();
+        wax::bench::do_not_optimize( sw );
+    }
+}
+
+//! @brief The sinks, made once by main() and shared by every benchmark thread.
+struct sinks {
+    int                                 fd          { ::open( "/dev/null", O_WRONLY ) };
+    wax::stopwatch::histogram           histogram;
+    wax::stopwatch::accumulator         accumulator;
+    wax::stopwatch::registry            registry;
+    wax::stopwatch::trace_file          trace;
+    wax::stopwatch::shared_segment      shared;
+    wax::stopwatch::chrome_trace        chrome      { "/dev/null" };
+
+    explicit sinks( const std::string &trace_path, const std::string &shm_name )
+        :
+        trace( trace_path.c_str() ),
+        shared( shm_name.c_str() )
+    {
+        // Nothing needs the trace by name once it's mapped.
+        ::unlink( trace_path.c_str() );
+    }
+};
+
+sinks *all = nullptr;
+
+const wax::stopwatch::label tag = label::handle { label::intern( "bench" ) };
+
+void construct_bare( wax::bench::state &st ) {
+    for ( auto _ : st ) {
+        watch< clock::monotonic > sw;
+        wax::bench::do_not_optimize( sw );
+    }
+}
+
+void construct_label( wax::bench::state &st ) {
+    for ( auto _ : st ) {
+        watch< clock::monotonic > sw( "bench" );
+        wax::bench::do_not_optimize( sw );
+    }
+}
+
+void construct_label_handle( wax::bench::state &st ) {
+    for ( auto _ : st ) {
+        watch< clock::monotonic > sw( tag );
+        wax::bench::do_not_optimize( sw );
+    }
+}
+
+//! One report line per iteration, formatted and written by the background thread.
+//
+// dropped() is process-wide, so only the first thread counts it, over its own loop.
+//
+void construct_fd_label( wax::bench::state &st ) {
+    const uint64_t before = wax::stopwatch::dropped();
+    for ( auto _ : st ) {
+        watch< clock::monotonic > sw( all->fd, tag );
+        wax::bench::do_not_optimize( sw );
+    }
+    if ( st.thread() == 0 ) st.counter( "dropped", wax::stopwatch::dropped() - before );
+}
+
+template< typename sink_type, sink_type sinks::*member >
+void sink( wax::bench::state &st ) {
+    sink_type &s = all->*member;
+    for ( auto _ : st ) {
+        watch< clock::monotonic > sw( s, tag );
+        wax::bench::do_not_optimize( sw );
+    }
+}
+
+void sink_fd( wax::bench::state &st ) {
+    construct_fd_label( st );
+}
+
+//! @brief Register fn as name/threads:t for t = 1, 2, 4, ... up to most, and most.
+void scaled( const char *name, wax::bench::function fn, unsigned most ) {
+    for ( unsigned t = 1; ; t *= 2 ) {
+        if ( t > most ) t = most;
+        wax::bench::add( ( std::string( name ) + "/threads:" + std::to_string( t ) ).c_str(),
+                         fn, t );
+        if ( t == most ) break;
+    }
+}
+
+}
+
+int main( int argc, char **argv ) {
+    unsigned most = std::thread::hardware_concurrency();
+    std::vector< char * > args { argv[ 0 ] };
+    for ( int i = 1; i < argc; ++i ) {
+        if ( ::strncmp( argv[ i ], "--threads=", 10 ) == 0 ) most = ::atoi( argv[ i ] + 10 );
+        else args.push_back( argv[ i ] );
+    }
+    if ( most == 0 ) most = 1;
+
+    const std::string pid = std::to_string( ::getpid() );
+    sinks s( "/tmp/sw_bench." + pid + ".trace", "/wax.sw_bench." + pid );
+    all = &s;
+    if ( s.fd < 0 || ! s.trace.is_open() || ! s.shared.is_open() || ! s.chrome.is_open() ) {
+        ::perror( "sw_bench: sinks" );
+        return 1;
+    }
+
+    wax::bench::add( "lap_ns/real",           lap_ns< clock::real > );
+    wax::bench::add( "lap_ns/monotonic",      lap_ns< clock::monotonic > );
+    wax::bench::add( "lap_ns/monotonic_raw",  lap_ns< clock::monotonic_raw > );
+    wax::bench::add( "lap_ns/coarse",         lap_ns< clock::coarse > );
+    wax::bench::add( "lap_ns/boottime",       lap_ns< clock::boottime > );
+    wax::bench::add( "lap_ns/cpu::thread",    lap_ns< clock::cpu::thread > );
+    wax::bench::add( "lap_ns/cpu::proc",      lap_ns< clock::cpu::proc > );
+    wax::bench::add( "lap_ns/tsc",            lap_ns< clock::tsc > );
+    wax::bench::add( "reset/real",            reset< clock::real > );
+    wax::bench::add( "reset/monotonic",       reset< clock::monotonic > );
+    wax::bench::add( "reset/monotonic_raw",   reset< clock::monotonic_raw > );
+    wax::bench::add( "reset/coarse",          reset< clock::coarse > );
+    wax::bench::add( "reset/boottime",        reset< clock::boottime > );
+    wax::bench::add( "reset/cpu::thread",     reset< clock::cpu::thread > );
+    wax::bench::add( "reset/cpu::proc",       reset< clock::cpu::proc > );
+    wax::bench::add( "reset/tsc",             reset< clock::tsc > );
+
+    wax::bench::add( "construct/bare",         construct_bare );
+    wax::bench::add( "construct/label",        construct_label );
+    wax::bench::add( "construct/label_handle", construct_label_handle );
+    wax::bench::add( "construct/fd_label",     construct_fd_label );
+
+    using wax::stopwatch::histogram;
+    using wax::stopwatch::accumulator;
+    using wax::stopwatch::registry;
+    using wax::stopwatch::trace_file;
+    using wax::stopwatch::shared_segment;
+    using wax::stopwatch::chrome_trace;
+    scaled( "sink/fd",          sink_fd,                                         most );
+    scaled( "sink/histogram",   sink< histogram, &sinks::histogram >,            most );
+    scaled( "sink/accumulator", sink< accumulator, &sinks::accumulator >,        most );
+    scaled( "sink/registry",    sink< registry, &sinks::registry >,              most );
+    scaled( "sink/trace",       sink< trace_file, &sinks::trace >,               most );
+    scaled( "sink/shared",      sink< shared_segment, &sinks::shared >,          most );
+    scaled( "sink/chrome",      sink< chrome_trace, &sinks::chrome >,            most );
+
+    const int status = wax::bench::run( (int) args.size(), args.data() );
+    wax::stopwatch::flush();
+    return status;
+}
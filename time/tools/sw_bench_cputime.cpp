@@ -0,0 +1,48 @@
+//! @file sw_bench_cputime.cpp
+//  @brief Cost of reading thread CPU time: the task-clock page against clock_gettime().
+//
+//  sw_bench_cputime [ wax::bench options ]
+//
+//  Reports on standard error whether this machine gets the page, then the benchmarks as JSON.
+//  Where it doesn't, cpu_thread and cpu_thread_syscall come out the same.
+//
+#include <stdio.h>
+#include <time.h>
+#include "../bench.hpp"
+#include "../stopwatch.hpp"
+
+namespace {
+
+using namespace ::wax::_impl;
+
+void cpu_thread_syscall( wax::bench::state &st ) {
+    for ( auto _ : st ) wax::bench::do_not_optimize( taskclock::syscall_ns() );
+}
+
+void cpu_thread( wax::bench::state &st ) {
+    for ( auto _ : st ) wax::bench::do_not_optimize( clock::ticks< clock::cpu::thread >() );
+}
+
+void cpu_thread_stopwatch( wax::bench::state &st ) {
+    for ( auto _ : st ) {
+        wax::stopwatch::cpu::thread sw;
+        wax::bench::do_not_optimize( sw.lap_ns() );
+    }
+}
+
+void monotonic( wax::bench::state &st ) {
+    for ( auto _ : st ) wax::bench::do_not_optimize( clock::ticks< clock::monotonic >() );
+}
+
+WAX_BENCHMARK( cpu_thread_syscall );
+WAX_BENCHMARK( cpu_thread );
+WAX_BENCHMARK( cpu_thread_stopwatch );
+WAX_BENCHMARK( monotonic );
+
+}
+
+int main( int argc, char **argv ) {
+    ::fprintf( stderr, "cpu::thread: %s\n", taskclock::direct() ? "task-clock page"
+                                                                 : "clock_gettime()" );
+    return wax::bench::run( argc, argv );
+}
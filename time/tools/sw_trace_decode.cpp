@@ -0,0 +1,88 @@
+//! @file sw_trace_decode.cpp
+//  @brief Convert a stopwatch::trace_file to CSV or Chrome trace JSON.
+//
+//  sw_trace_decode [ --csv | --chrome ] trace-file
+//
+//  CSV has one row per complete entry, oldest first.  Chrome output loads in chrome://tracing
+//  and Perfetto as complete ("X") events; CPU-time clocks have no timeline and are left out.
+//
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include "../stopwatch.hpp"
+
+namespace {
+
+using namespace ::wax::_impl;
+
+//! @brief Write s as the body of a quoted string, dropping control characters.
+//  @param json Escape for JSON; otherwise double quotes the CSV way.
+void quoted( FILE *out, const std::string &s, bool json ) {
+    for ( const char c : s ) {
+        if ( (unsigned char) c < 0x20 ) continue;
+        if ( c == '"' ) fputc( json ? '\\' : '"', out );
+        else if ( c == '\\' && json ) fputc( '\\', out );
+        fputc( c, out );
+    }
+}
+
+}
+
+int main( int argc, char **argv ) {
+    bool        chrome = false;
+    const char *path   = nullptr;
+    for ( int i = 1; i < argc; ++i ) {
+        if ( ! strcmp( argv[ i ], "--chrome" ) )   chrome = true;
+        else if ( ! strcmp( argv[ i ], "--csv" ) ) chrome = false;
+        else                                       path   = argv[ i ];
+    }
+    if ( ! path ) {
+        fprintf( stderr, "usage: %s [ --csv | --chrome ] trace-file\n", argv[ 0 ] );
+        return 2;
+    }
+
+    trace::view trace( path );
+    if ( ! trace.is_open() ) {
+        fprintf( stderr, "%s: %s\n", path, strerror( errno ) );
+        return 1;
+    }
+
+    std::unordered_map< uint32_t, std::string > labels;
+    trace.each_label( [&]( uint32_t id, const char *name, uint32_t len ) {
+        labels.emplace( id, std::string( name, len ) ); } );
+    auto label = [&]( uint32_t id ) -> std::string {
+        if ( id == 0 ) return "<anon>";
+        auto found = labels.find( id );
+        return found != labels.end() ? found->second : "#" + std::to_string( id );
+    };
+
+    const auto &info = trace.info();
+    bool        any  = false;
+    if ( chrome )
+        printf( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" );
+    else
+        printf( "index,clock,pid,tid,label,start_ns,ns\n" );
+
+    for ( uint64_t i = trace.first(), end = trace.end(); i < end; ++i ) {
+        trace::event e;
+        if ( ! trace.read( i, e ) ) continue;
+        if ( chrome ) {
+            if ( e.clock == clock::cpu::thread || e.clock == clock::cpu::proc ) continue;
+            printf( "%s\n{\"ph\":\"X\",\"name\":\"", any ? "," : "" );
+            quoted( stdout, label( e.label ), true );
+            printf( "\",\"cat\":\"%s\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    format::clock_name( e.clock ), info.pid, e.tid,
+                    e.start / 1000.0, e.ns / 1000.0 );
+        } else {
+            printf( "%lu,%s,%u,%u,\"", (unsigned long) i, format::clock_name( e.clock ), info.pid,
+                    e.tid );
+            quoted( stdout, label( e.label ), false );
+            printf( "\",%ld,%ld\n", (long) e.start, (long) e.ns );
+        }
+        any = true;
+    }
+
+    if ( chrome ) printf( "\n]}\n" );
+    return 0;
+}